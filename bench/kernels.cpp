@@ -0,0 +1,471 @@
+// microbenchmarks for the hot kernels on synthetic reads
+//
+// usage: bench [l] [k] [d] [read_length] [reads]
+//
+// reads are error free and sampled from both strands of a random genome
+// covering it 10 times, all randomness is seeded so runs are comparable
+// between commits; results are printed as JSON, times in ns per operation
+
+#include <mdbg/arena.hpp>
+#include <mdbg/batching.hpp>
+#include <mdbg/graph/construction.hpp>
+#include <mdbg/graph/simplification.hpp>
+#include <mdbg/hash.hpp>
+#include <mdbg/io/parser.hpp>
+#include <mdbg/minimizers.hpp>
+#include <mdbg/opt.hpp>
+#include <mdbg/util.hpp>
+
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <zlib.h>
+
+#include <tbb/enumerable_thread_specific.h>
+#include <tbb/task_group.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <mutex>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace {
+
+  // keeps results alive so the measured work is not optimized away
+  volatile ::std::size_t sink = 0;
+
+  constexpr ::std::size_t repetitions = 7;
+  constexpr ::std::int64_t min_repetition_ns = 20'000'000;
+
+  bool first_result = true;
+
+  // runs f, which performs 'ops' operations, until each repetition takes
+  // long enough to time, and reports the min and median per operation
+  template<typename F>
+  void run(char const* name, char const* unit, ::std::size_t const ops, F&& f) noexcept {
+    sink = sink + f();
+
+    ::std::vector<double> per_op;
+    ::std::size_t calls = 1;
+
+    while (per_op.size() < repetitions) {
+      ::mdbg::timer timer;
+      for (::std::size_t i = 0; i < calls; ++i) {
+        sink = sink + f();
+      }
+      auto const ns =
+        ::std::chrono::duration_cast<::std::chrono::nanoseconds>(timer.get()).count();
+
+      if (ns < min_repetition_ns && per_op.empty()) {
+        calls *= 2;
+        continue;
+      }
+
+      per_op.push_back(
+        static_cast<double>(ns) / static_cast<double>(calls * ops));
+    }
+
+    ::std::sort(per_op.begin(), per_op.end());
+
+    ::std::printf(
+      "%s    {\"name\": \"%s\", \"unit\": \"%s\", \"ops\": %lu, \"calls\": %lu, "
+      "\"min_ns\": %.3f, \"median_ns\": %.3f}",
+      first_result ? "" : ",\n",
+      name, unit, ops, calls, per_op.front(), per_op[per_op.size() / 2]);
+    ::std::fflush(stdout);
+
+    first_result = false;
+  }
+
+  char complement(char const base) noexcept {
+    switch (base) {
+      case 'A': return 'T';
+      case 'C': return 'G';
+      case 'G': return 'C';
+      default:  return 'A';
+    }
+  }
+
+  ::std::vector<::std::string> simulate_reads(
+    ::std::size_t const read_length,
+    ::std::size_t const reads,
+    ::std::mt19937_64& mt
+  ) noexcept {
+    ::std::string genome(::std::max(read_length * reads / 10, read_length), 'A');
+    for (auto& base : genome) {
+      base = "ACGT"[mt() & 3];
+    }
+
+    ::std::uniform_int_distribution<::std::size_t> position(
+      0, genome.size() - read_length);
+
+    ::std::vector<::std::string> rv(reads);
+    for (auto& read : rv) {
+      read = genome.substr(position(mt), read_length);
+
+      if (mt() & 1) {
+        ::std::reverse(read.begin(), read.end());
+        ::std::transform(read.begin(), read.end(), read.begin(), complement);
+      }
+    }
+
+    return rv;
+  }
+
+  // gzip compressed FASTA kept in an anonymous memory backed file, so
+  // parsing does not touch the disk but goes through the usual path
+  class memory_file {
+    int fd;
+
+   public:
+    explicit memory_file(::std::vector<::std::string> const& reads) noexcept
+      : fd(::memfd_create("bench.fa.gz", 0))
+    {
+      if (fd == -1) {
+        ::mdbg::terminate("unable to create in memory file");
+      }
+
+      auto* out = ::gzdopen(::dup(fd), "w");
+      for (::std::size_t i = 0; i < reads.size(); ++i) {
+        ::gzprintf(out, ">read%lu\n", i);
+        ::gzwrite(out, reads[i].data(), static_cast<unsigned>(reads[i].size()));
+        ::gzputc(out, '\n');
+      }
+      ::gzclose(out);
+    }
+
+    ~memory_file() {
+      ::close(fd);
+    }
+
+    ::std::string path() const noexcept {
+      return "/proc/self/fd/" + ::std::to_string(fd);
+    }
+
+    ::std::size_t size() const noexcept {
+      return static_cast<::std::size_t>(::lseek(fd, 0, SEEK_END));
+    }
+  };
+
+}
+
+int main(int argc, char** argv) {
+  ::mdbg::command_line_options opts{};
+  opts.l = argc > 1 ? ::std::stoul(argv[1]) : 14;
+  opts.k = argc > 2 ? ::std::stoul(argv[2]) : 20;
+  opts.d = argc > 3 ? ::std::stod(argv[3]) : 0.01;
+  opts.sequences = true;
+  opts.input = "synthetic";
+  opts.output_prefix = "synthetic";
+  opts.resolve_defaults();
+
+  ::std::size_t const read_length = argc > 4 ? ::std::stoul(argv[4]) : 10'000;
+  ::std::size_t const read_count = argc > 5 ? ::std::stoul(argv[5]) : 1'000;
+
+  ::std::mt19937_64 mt{42};
+
+  auto const reads = simulate_reads(read_length, read_count, mt);
+  ::std::size_t const bases = read_length * read_count;
+
+  ::std::vector<::mdbg::read_minimizers_t> minimizers(reads.size());
+  ::std::size_t minimizer_count = 0;
+  for (::std::size_t i = 0; i < reads.size(); ++i) {
+    minimizers[i] = ::mdbg::detect_minimizers(reads[i], i, opts);
+    minimizer_count += minimizers[i].size();
+  }
+
+  ::std::vector<::std::uint64_t> values(1 << 16);
+  for (auto& value : values) {
+    value = mt();
+  }
+
+  ::std::printf(
+    "{\n  \"l\": %lu,\n  \"k\": %lu,\n  \"d\": %g,\n"
+    "  \"read_length\": %lu,\n  \"reads\": %lu,\n  \"minimizers\": %lu,\n"
+    "  \"results\": [\n",
+    opts.l, opts.k, opts.d, read_length, read_count, minimizer_count);
+
+  run("detect_minimizers", "base", bases, [&] {
+    ::std::size_t found = 0;
+    for (::std::size_t i = 0; i < reads.size(); ++i) {
+      found += ::mdbg::detect_minimizers(reads[i], i, opts).size();
+    }
+    return found;
+  });
+
+  // the same without the code compiled for the common values of l
+  run("detect_minimizers_generic", "base", bases, [&] {
+    ::std::size_t found = 0;
+    for (::std::size_t i = 0; i < reads.size(); ++i) {
+      found += ::mdbg::detail::detect_minimizers_generic(
+        reads[i], i, opts, ::std::pmr::get_default_resource()).size();
+    }
+    return found;
+  });
+
+  // the other minimizer schemes at the same density
+  for (auto const scheme : {
+      ::mdbg::minimizer_scheme::closed_syncmer,
+      ::mdbg::minimizer_scheme::open_syncmer,
+      ::mdbg::minimizer_scheme::bounded}) {
+    auto scheme_opts = opts;
+    scheme_opts.scheme = scheme;
+
+    auto const name = ::std::string{"detect_minimizers_"} + ::mdbg::scheme_name(scheme);
+    run(name.c_str(), "base", bases, [&] {
+      ::std::size_t found = 0;
+      for (::std::size_t i = 0; i < reads.size(); ++i) {
+        found += ::mdbg::detect_minimizers(reads[i], i, scheme_opts).size();
+      }
+      return found;
+    });
+  }
+
+  // the same reads read with homopolymer runs collapsed
+  auto hpc_opts = opts;
+  hpc_opts.hpc = true;
+
+  run("detect_minimizers_hpc", "base", bases, [&] {
+    ::std::size_t found = 0;
+    for (::std::size_t i = 0; i < reads.size(); ++i) {
+      found += ::mdbg::detect_minimizers(reads[i], i, hpc_opts).size();
+    }
+    return found;
+  });
+
+  // results kept alive as in mdbg, once on the heap and once in an arena
+  run("detect_minimizers_kept", "base", bases, [&] {
+    ::std::vector<::mdbg::read_minimizers_t> kept;
+    kept.reserve(reads.size());
+    for (::std::size_t i = 0; i < reads.size(); ++i) {
+      kept.push_back(::mdbg::detect_minimizers(reads[i], i, opts));
+    }
+    return kept.size();
+  });
+
+  run("detect_minimizers_arena", "base", bases, [&] {
+    ::mdbg::arena arena;
+    ::std::vector<::mdbg::read_minimizers_t> kept;
+    kept.reserve(reads.size());
+    for (::std::size_t i = 0; i < reads.size(); ++i) {
+      kept.push_back(::mdbg::detect_minimizers(reads[i], i, opts, &arena));
+    }
+    return kept.size();
+  });
+
+  run("hash128::advance", "value", values.size(), [&] {
+    ::mdbg::hash128 hash;
+    for (auto const value : values) {
+      hash.advance(value);
+    }
+    return static_cast<::std::size_t>(hash.collapse());
+  });
+
+  run("hash128::rotate", "value", values.size() - opts.k, [&] {
+    ::mdbg::hash128 hash;
+    for (::std::size_t i = 0; i + 1 < opts.k; ++i) {
+      hash.advance(values[i]);
+    }
+    for (auto i = opts.k; i < values.size(); ++i) {
+      hash.rotate(values[i], values[i - opts.k], opts.k - 1);
+    }
+    return static_cast<::std::size_t>(hash.collapse());
+  });
+
+  run("hash128::collapse", "value", values.size(), [&] {
+    ::std::size_t sum = 0;
+    ::mdbg::hash128 hash;
+    for (auto const value : values) {
+      hash.lower = value;
+      sum += hash.collapse();
+    }
+    return sum;
+  });
+
+  run("hash64::rotate", "value", values.size() - opts.k, [&] {
+    ::mdbg::hash64 hash;
+    for (::std::size_t i = 0; i + 1 < opts.k; ++i) {
+      hash.advance(values[i]);
+    }
+    for (auto i = opts.k; i < values.size(); ++i) {
+      hash.rotate(values[i], values[i - opts.k], opts.k - 1);
+    }
+    return static_cast<::std::size_t>(hash.collapse());
+  });
+
+  run("hash64::collapse", "value", values.size(), [&] {
+    ::std::size_t sum = 0;
+    ::mdbg::hash64 hash;
+    for (auto const value : values) {
+      hash.value = value;
+      sum += hash.collapse();
+    }
+    return sum;
+  });
+
+  // window hashing alone, with and without the shift range of k
+  run("for_each_window", "minimizer", minimizer_count, [&] {
+    ::std::size_t sum = 0;
+    for (auto const& read_minimizers : minimizers) {
+      ::mdbg::graph::for_each_window(read_minimizers, opts, [&sum](auto const& window) {
+        sum += window.cached_hash.collapse();
+      });
+    }
+    return sum;
+  });
+
+  run("for_each_window_generic", "minimizer", minimizer_count, [&] {
+    ::std::size_t sum = 0;
+    for (auto const& read_minimizers : minimizers) {
+      ::mdbg::graph::for_each_window<::mdbg::shift_range::any>(
+        read_minimizers, opts, [&sum](auto const& window) {
+          sum += window.cached_hash.collapse();
+        });
+    }
+    return sum;
+  });
+
+  run("construct_one_read", "minimizer", minimizers.front().size(), [&] {
+    ::mdbg::graph::de_bruijn_graph_t graph;
+    ::mdbg::graph::construct(graph, minimizers.front(), opts);
+    return graph.size();
+  });
+
+  run("construct_many_reads", "minimizer", minimizer_count, [&] {
+    ::mdbg::graph::de_bruijn_graph_t graph;
+    ::mdbg::graph::construct(graph, minimizers.cbegin(), minimizers.cend(), opts);
+    return graph.size();
+  });
+
+  run("construct_many_reads_batched", "minimizer", minimizer_count, [&] {
+    ::mdbg::graph::de_bruijn_graph_t graph;
+    ::mdbg::graph::construction_batch batch;
+    for (auto const& read : minimizers) {
+      ::mdbg::graph::construct(batch, read, opts);
+      if (batch.full()) {
+        ::mdbg::graph::flush(graph, batch);
+      }
+    }
+    ::mdbg::graph::flush(graph, batch);
+    return graph.size();
+  });
+
+  // detection and construction of all reads scheduled as mdbg did before
+  // batching, two tasks per read each spawned under a lock, and as it does
+  // now, one task per batch of reads
+  auto const schedule = [&](bool const batched) {
+    ::mdbg::graph::de_bruijn_graph_t graph;
+    ::tbb::enumerable_thread_specific<::mdbg::graph::construction_batch> batches;
+    ::std::vector<::mdbg::read_minimizers_t> detected(reads.size());
+
+    ::tbb::task_group tg;
+    ::std::mutex tg_lock;
+
+    auto const construct = [&](::std::size_t const i) {
+      auto& batch = batches.local();
+      ::mdbg::graph::construct(batch, detected[i], opts);
+      if (batch.full()) {
+        ::mdbg::graph::flush(graph, batch);
+      }
+    };
+
+    if (!batched) {
+      for (::std::size_t i = 0; i < reads.size(); ++i) {
+        ::std::scoped_lock<::std::mutex> scoped_detection{tg_lock};
+        tg.run([&, i] {
+          detected[i] = ::mdbg::detect_minimizers(reads[i], i, opts);
+          ::std::scoped_lock<::std::mutex> scoped_construction{tg_lock};
+          tg.run([&, i] { construct(i); });
+        });
+      }
+    } else {
+      ::mdbg::batch_target target;
+      ::std::size_t begin = 0, batch_bases = 0;
+
+      for (::std::size_t i = 0; i < reads.size(); ++i) {
+        batch_bases += reads[i].size();
+        if (batch_bases < target.bases() && i + 1 < reads.size()) {
+          continue;
+        }
+
+        tg.run([&, begin, end = i + 1] {
+          for (auto j = begin; j < end; ++j) {
+            detected[j] = ::mdbg::detect_minimizers(reads[j], j, opts);
+          }
+          for (auto j = begin; j < end; ++j) {
+            construct(j);
+          }
+        });
+
+        begin = i + 1;
+        batch_bases = 0;
+        target.next();
+      }
+    }
+
+    tg.wait();
+    for (auto& batch : batches) {
+      ::mdbg::graph::flush(graph, batch);
+    }
+    return graph.size();
+  };
+
+  run("schedule_per_read", "read", reads.size(), [&] {
+    return schedule(false);
+  });
+
+  run("schedule_batched", "read", reads.size(), [&] {
+    return schedule(true);
+  });
+
+  ::mdbg::graph::de_bruijn_graph_t graph;
+  ::mdbg::graph::construct(graph, minimizers.cbegin(), minimizers.cend(), opts);
+
+  // simplify walks a unitig from every start node, most of its time is unitig
+  run("unitig", "node", graph.size(), [&] {
+    return ::mdbg::graph::simplify(graph).size();
+  });
+
+  memory_file const compressed{reads};
+
+  run("parse_fasta", "base", bases, [&] {
+    ::std::size_t parsed = 0;
+    ::mdbg::io::fasta_constumer consumer = [&parsed](auto&&, auto&& seq) {
+      parsed += seq.size();
+    };
+    ::mdbg::io::parse_fasta(compressed.path().c_str(), consumer);
+    return parsed;
+  });
+
+  // a third of the reads kept, the others skipped without being copied
+  run("parse_fasta_sampled", "base", bases, [&] {
+    ::std::size_t parsed = 0;
+    ::mdbg::io::fasta_constumer consumer = [&parsed](auto&&, auto&& seq) {
+      parsed += seq.size();
+    };
+    ::mdbg::io::parse_fasta(compressed.path().c_str(), consumer, {1.0 / 3});
+    return parsed;
+  });
+
+  auto const simplified = ::mdbg::graph::simplify(graph);
+
+  run("write_gfa", "segment", simplified.size(), [&] {
+    ::std::ostringstream out;
+    ::mdbg::graph::write_gfa(
+      out,
+      simplified,
+      [&reads](auto&& i) -> ::std::string const& { return reads[i]; },
+      opts);
+    return out.str().size();
+  });
+
+  ::std::printf(
+    "\n  ],\n  \"nodes\": %lu,\n  \"unitigs\": %lu,\n  \"compressed_bytes\": %lu\n}\n",
+    graph.size(), simplified.size(), compressed.size());
+}
@@ -0,0 +1,157 @@
+// compares node lookups through the concurrent graph and through the
+// flat node index
+//
+// usage: bench_node_index [nodes] [lookups]
+//
+// cache misses are read from perf_event_open and reported as null when
+// hardware counters are not available
+
+#include <mdbg/graph/construction.hpp>
+#include <mdbg/graph/node_index.hpp>
+#include <mdbg/util.hpp>
+
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+
+  class cache_miss_counter {
+    int fd = -1;
+
+   public:
+    cache_miss_counter() noexcept {
+      ::perf_event_attr attr;
+      ::std::memset(&attr, 0, sizeof(attr));
+      attr.size = sizeof(attr);
+      attr.type = PERF_TYPE_HARDWARE;
+      attr.config = PERF_COUNT_HW_CACHE_MISSES;
+      attr.disabled = 1;
+      attr.exclude_kernel = 1;
+      attr.exclude_hv = 1;
+
+      fd = static_cast<int>(::syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0));
+    }
+
+    ~cache_miss_counter() {
+      if (fd != -1) {
+        ::close(fd);
+      }
+    }
+
+    bool available() const noexcept {
+      return fd != -1;
+    }
+
+    void start() noexcept {
+      if (available()) {
+        ::ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+        ::ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+      }
+    }
+
+    ::std::uint64_t stop() noexcept {
+      ::std::uint64_t count = 0;
+      if (available()) {
+        ::ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+        if (::read(fd, &count, sizeof(count)) != sizeof(count)) {
+          count = 0;
+        }
+      }
+      return count;
+    }
+  };
+
+  template<typename F>
+  void measure(
+    char const* name,
+    ::std::vector<::mdbg::node_hash> const& keys,
+    cache_miss_counter& counter,
+    bool const last,
+    F&& lookups
+  ) noexcept {
+    ::mdbg::timer timer;
+    counter.start();
+
+    auto const found = lookups();
+
+    auto const misses = counter.stop();
+    auto const ns = 
+      ::std::chrono::duration_cast<::std::chrono::nanoseconds>(timer.get()).count();
+    auto const n = static_cast<double>(keys.size());
+
+    ::std::printf(
+      "    {\"name\": \"%s\", \"found\": %lu, \"ns_per_lookup\": %.2f, ",
+      name, found, static_cast<double>(ns) / n);
+
+    if (counter.available()) {
+      ::std::printf("\"misses_per_lookup\": %.3f}", static_cast<double>(misses) / n);
+    } else {
+      ::std::printf("\"misses_per_lookup\": null}");
+    }
+
+    ::std::printf(last ? "\n" : ",\n");
+  }
+
+}
+
+int main(int argc, char** argv) {
+  ::std::size_t const nodes = argc > 1 ? ::std::stoul(argv[1]) : 1ul << 22;
+  ::std::size_t const lookups = argc > 2 ? ::std::stoul(argv[2]) : 1ul << 22;
+
+  ::std::mt19937_64 mt{42};
+
+  ::mdbg::graph::de_bruijn_graph_t dbg;
+  ::std::vector<::mdbg::node_hash> inserted(nodes);
+
+  for (auto& key : inserted) {
+    key = {};
+    key.advance(mt());
+    key.advance(mt());
+    dbg.insert({{{}, key, false}, {}});
+  }
+
+  ::mdbg::graph::node_index const index{dbg};
+
+  ::std::vector<::mdbg::node_hash> keys(lookups);
+  ::std::uniform_int_distribution<::std::size_t> pick(0, nodes - 1);
+  for (auto& key : keys) {
+    key = inserted[pick(mt)];
+  }
+
+  cache_miss_counter counter;
+
+  ::std::printf(
+    "{\n  \"nodes\": %lu,\n  \"lookups\": %lu,\n  \"results\": [\n",
+    nodes, lookups);
+
+  measure("concurrent_hash_map", keys, counter, false, [&] {
+    ::std::size_t found = 0;
+    ::mdbg::graph::de_bruijn_graph_t::const_accessor accessor;
+    for (auto const& key : keys) {
+      found += dbg.find(accessor, {{}, key, false}) && accessor->second.count == 0;
+    }
+    return found;
+  });
+
+  measure("node_index", keys, counter, true, [&] {
+    ::std::size_t found = 0;
+    for (auto const& key : keys) {
+      auto const* node = index.find(key);
+      found += node != nullptr && node->second.count == 0;
+    }
+    return found;
+  });
+
+  ::std::printf("  ]\n}\n");
+}
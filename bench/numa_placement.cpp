@@ -0,0 +1,187 @@
+// compares random probes into a table split in one shard per NUMA node,
+// probed by workers pinned to the shard's node, with the shards placed
+//
+//   local        first touched by workers of the node probing them
+//   remote       first touched by workers of the next node
+//   interleaved  pages spread round robin over all nodes by mbind
+//
+// usage: bench_numa [megabytes] [probes]
+//
+// on a machine with a single node all placements are the same memory,
+// the numbers then only show the noise of the measurement
+
+#include <mdbg/numa.hpp>
+#include <mdbg/util.hpp>
+
+#include <linux/mempolicy.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <tbb/blocked_range.h>
+#include <tbb/info.h>
+#include <tbb/parallel_for.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+namespace {
+
+  using word = ::std::uint64_t;
+
+  class table {
+    word* data;
+    ::std::size_t bytes;
+
+   public:
+    explicit table(::std::size_t const bytes) noexcept
+        : bytes(bytes) {
+      auto* const ptr = ::mmap(nullptr, bytes, PROT_READ | PROT_WRITE,
+        MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+      if (ptr == MAP_FAILED) {
+        ::mdbg::terminate("unable to map ", bytes, " bytes");
+      }
+      data = static_cast<word*>(ptr);
+    }
+
+    ~table() {
+      ::munmap(data, bytes);
+    }
+
+    table(table const&) = delete;
+    table& operator=(table const&) = delete;
+
+    word* begin() const noexcept {
+      return data;
+    }
+
+    ::std::size_t size() const noexcept {
+      return bytes / sizeof(word);
+    }
+
+    // places pages round robin on the given nodes before they are touched,
+    // false when the kernel has no NUMA support
+    bool interleave(::std::vector<int> const& nodes) noexcept {
+      unsigned long mask = 0;
+      for (auto const node : nodes) {
+        mask |= 1ul << ::std::max(node, 0);
+      }
+      return ::syscall(SYS_mbind, data, bytes, MPOL_INTERLEAVE,
+        &mask, sizeof(mask) * 8, 0) == 0;
+    }
+  };
+
+  enum class placement { local, remote, interleaved };
+
+  // the shard of node 'node' out of 'nodes'
+  ::std::pair<word*, ::std::size_t> shard(
+    table const& t,
+    ::std::size_t const node,
+    ::std::size_t const nodes
+  ) noexcept {
+    auto const size = t.size() / nodes;
+    return {t.begin() + node * size, size};
+  }
+
+  // writes every page of the shards from the workers of the given nodes
+  void touch(
+    ::mdbg::numa::node_arenas& arenas,
+    table const& t,
+    ::std::size_t const offset
+  ) noexcept {
+    auto const nodes = arenas.size();
+    for (::std::size_t node = 0; node < nodes; ++node) {
+      auto const [begin, size] = shard(t, (node + offset) % nodes, nodes);
+      arenas.run(node, [begin = begin, size = size] {
+        ::tbb::parallel_for(::tbb::blocked_range<::std::size_t>(0, size),
+          [begin](auto const& range) {
+            for (auto i = range.begin(); i != range.end(); ++i) {
+              begin[i] = i;
+            }
+          });
+      });
+    }
+    arenas.wait();
+  }
+
+  // dependent random reads, so that every probe waits for memory
+  double probe(
+    ::mdbg::numa::node_arenas& arenas,
+    table const& t,
+    ::std::size_t const probes
+  ) noexcept {
+    auto const nodes = arenas.size();
+    ::std::atomic<word> sink{0};
+    ::mdbg::timer timer;
+
+    for (::std::size_t node = 0; node < nodes; ++node) {
+      auto const [begin, size] = shard(t, node, nodes);
+      auto const per_node = probes / nodes;
+      arenas.run(node, [begin = begin, size = size, per_node, &sink] {
+        ::tbb::parallel_for(::tbb::blocked_range<::std::size_t>(0, per_node, 1 << 14),
+          [begin, size, &sink](auto const& range) {
+            word x = range.begin() * 0x9e3779b97f4a7c15ul + 1;
+            for (auto i = range.begin(); i != range.end(); ++i) {
+              x ^= x << 13;
+              x ^= x >> 7;
+              x ^= x << 17;
+              x += begin[x % size];
+            }
+            sink.fetch_add(x, ::std::memory_order_relaxed);
+          });
+      });
+    }
+    arenas.wait();
+
+    auto const ns =
+      ::std::chrono::duration_cast<::std::chrono::nanoseconds>(timer.get()).count();
+    return static_cast<double>(ns) / static_cast<double>(probes);
+  }
+
+  void measure(
+    char const* name,
+    placement const where,
+    ::mdbg::numa::node_arenas& arenas,
+    ::std::size_t const bytes,
+    ::std::size_t const probes,
+    bool const last
+  ) noexcept {
+    table t{bytes};
+
+    auto applied = true;
+    if (where == placement::interleaved) {
+      applied = t.interleave(::tbb::info::numa_nodes());
+    }
+    touch(arenas, t, where == placement::remote ? 1 : 0);
+
+    auto const ns = probe(arenas, t, probes);
+
+    ::std::printf(
+      "    {\"name\": \"%s\", \"placed\": %s, \"ns_per_probe\": %.2f}%s\n",
+      name, applied ? "true" : "false", ns, last ? "" : ",");
+  }
+
+}
+
+int main(int argc, char** argv) {
+  ::std::size_t const megabytes = argc > 1 ? ::std::stoul(argv[1]) : 1024;
+  ::std::size_t const probes = argc > 2 ? ::std::stoul(argv[2]) : 1ul << 25;
+  auto const bytes = megabytes << 20;
+
+  ::mdbg::numa::node_arenas arenas{0};
+
+  ::std::printf(
+    "{\n  \"numa_nodes\": %lu,\n  \"bytes\": %lu,\n  \"probes\": %lu,\n"
+    "  \"results\": [\n",
+    arenas.size(), bytes, probes);
+
+  measure("local", placement::local, arenas, bytes, probes, false);
+  measure("remote", placement::remote, arenas, bytes, probes, false);
+  measure("interleaved", placement::interleaved, arenas, bytes, probes, true);
+
+  ::std::printf("  ]\n}\n");
+}
@@ -0,0 +1,130 @@
+// end to end scaling of the whole pipeline on simulated genomes
+//
+// usage: bench_scaling mdbg [max_genome_size] [threads] [coverage] [mdbg options...]
+//
+// for genome sizes 1 Mb, 10 Mb, ... up to max_genome_size (default 1 Gb)
+// a seeded random genome with inverted repeats is generated and HiFi like
+// reads are simulated from it, then mdbg is run once per thread count in
+// the comma separated 'threads' list; run time and peak memory are read
+// from the metrics file mdbg writes and printed as JSON
+
+#include <mdbg/sim/read_sim.hpp>
+#include <mdbg/util.hpp>
+
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace {
+
+  struct run_result {
+    double wall_ms;
+    double cpu_ms;
+    ::std::size_t peak_rss;
+  };
+
+  run_result read_metrics(::std::string const& path) noexcept {
+    ::std::ifstream in{path};
+    ::std::stringstream contents;
+    contents << in.rdbuf();
+
+    auto const text = contents.str();
+    auto const total = text.find("\"total\"");
+    if (total == ::std::string::npos) {
+      ::mdbg::terminate("no totals in ", path);
+    }
+
+    run_result rv{};
+    if (::std::sscanf(
+          text.c_str() + total,
+          "\"total\": {\"wall_ms\": %lf, \"cpu_ms\": %lf, \"peak_rss_bytes\": %lu",
+          &rv.wall_ms, &rv.cpu_ms, &rv.peak_rss) != 3) {
+      ::mdbg::terminate("malformed totals in ", path);
+    }
+
+    return rv;
+  }
+
+  ::std::vector<::std::size_t> parse_list(::std::string const& arg) noexcept {
+    ::std::vector<::std::size_t> rv;
+    ::std::stringstream in{arg};
+
+    for (::std::string item; ::std::getline(in, item, ',');) {
+      rv.push_back(::std::stoul(item));
+    }
+
+    return rv;
+  }
+
+}
+
+int main(int argc, char** argv) {
+  if (argc < 2) {
+    ::mdbg::terminate(
+      "usage: bench_scaling mdbg [max_genome_size] [threads] [coverage] "
+      "[mdbg options...]");
+  }
+
+  ::std::string const mdbg = argv[1];
+  ::std::size_t const max_size = argc > 2 ? ::std::stoul(argv[2]) : 1'000'000'000;
+  auto const threads = parse_list(argc > 3 ? argv[3] : "1,2,4,8");
+  auto const coverage = argc > 4 ? ::std::stoul(argv[4]) : 10;
+
+  ::std::string mdbg_options;
+  for (int i = 5; i < argc; ++i) {
+    mdbg_options += " ";
+    mdbg_options += argv[i];
+  }
+  if (mdbg_options.empty()) {
+    mdbg_options = " -k 20 -l 14 -d 0.01";
+  }
+
+  auto config = ::mdbg::sim::configurations::PacBioHiFi;
+  config.min_coverage = static_cast<decltype(config.min_coverage)>(coverage);
+
+  auto const directory = ::std::filesystem::temp_directory_path() / "mdbg_scaling";
+  ::std::filesystem::create_directories(directory);
+
+  ::std::printf("{\n  \"options\": \"%s\",\n  \"runs\": [\n", mdbg_options.c_str() + 1);
+  bool first = true;
+
+  for (::std::size_t size = 1'000'000; size <= max_size; size *= 10) {
+    auto genome = ::mdbg::sim::random_genome(size, 42);
+    ::mdbg::sim::inject_repeats(genome, {size / 1'000'000 * 10, 10'000, 0.001, true}, 43);
+
+    auto const reads_path = (directory / ("reads_" + ::std::to_string(size) + ".fa.gz")).string();
+    auto const reads = ::mdbg::sim::write_reads(
+      reads_path, genome, config, ::mdbg::sim::error_models::PacBioHiFi, 44);
+
+    genome = {};
+
+    for (auto const t : threads) {
+      auto const output = (directory / ("out_" + ::std::to_string(size))).string();
+      auto const command =
+        mdbg + " -t " + ::std::to_string(t) + mdbg_options
+          + " " + reads_path + " " + output + " > /dev/null";
+
+      if (::std::system(command.c_str()) != 0) {
+        ::mdbg::terminate("failed to run: ", command);
+      }
+
+      auto const result = read_metrics(output + ".metrics.json");
+
+      ::std::printf(
+        "%s    {\"genome_size\": %lu, \"reads\": %lu, \"threads\": %lu, "
+        "\"wall_ms\": %.3f, \"cpu_ms\": %.3f, \"peak_rss_bytes\": %lu}",
+        first ? "" : ",\n",
+        size, reads, t, result.wall_ms, result.cpu_ms, result.peak_rss);
+      ::std::fflush(stdout);
+      first = false;
+    }
+
+    ::std::filesystem::remove(reads_path);
+  }
+
+  ::std::printf("\n  ]\n}\n");
+}
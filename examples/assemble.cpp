@@ -0,0 +1,120 @@
+// assembly of reads held in memory through the mdbg_core library
+//
+// usage: example_assemble [genome_size] [read_length]
+//
+// error free reads are cut from a seeded random genome, every other one
+// reverse complemented, and pushed packed back to back into a single
+// buffer; the unitigs are spelled from the pieces of the reads and looked
+// up in the genome, once assembled in memory and once in partitions with
+// a memory budget, which needs opts.sequences to keep the bases
+
+#include <mdbg/assembler.hpp>
+#include <mdbg/opt.hpp>
+#include <mdbg/sim/read_sim.hpp>
+#include <mdbg/util.hpp>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace {
+
+  ::std::string reverse_complement(::std::string_view const bases) noexcept {
+    ::std::string rv{bases.rbegin(), bases.rend()};
+    for (auto& base : rv) {
+      switch (base) {
+        case 'A': base = 'T'; break;
+        case 'C': base = 'G'; break;
+        case 'G': base = 'C'; break;
+        case 'T': base = 'A'; break;
+      }
+    }
+    return rv;
+  }
+
+  // returns the number of unitigs found in neither strand of the genome
+  ::std::size_t assemble(
+    ::mdbg::command_line_options const& opts,
+    ::std::string const& genome,
+    ::std::string_view const bases,
+    ::std::vector<::std::size_t> const& ends
+  ) noexcept {
+    ::mdbg::assembler assembler{opts};
+    assembler.push(bases, ends);
+    auto const assembly = assembler.finish();
+
+    auto const reversed = reverse_complement(genome);
+    ::std::size_t length = 0;
+    ::std::size_t missing = 0;
+
+    for (auto const& unitig : assembly.unitigs()) {
+      ::std::string spelled;
+      assembly.for_each_piece(unitig, [&spelled](auto const piece, bool const rc) {
+        spelled += rc ? reverse_complement(piece) : ::std::string{piece};
+      });
+
+      if (spelled.size() != assembly.length(unitig)) {
+        ::mdbg::terminate("spelled ", spelled.size(), " bases of a unitig of ",
+          assembly.length(unitig));
+      }
+
+      length += spelled.size();
+      if (genome.find(spelled) == ::std::string::npos
+          && reversed.find(spelled) == ::std::string::npos) {
+        ++missing;
+      }
+    }
+
+    ::std::printf(
+      "%s: %lu unitig(s) of %lu bases, %lu not in the genome\n",
+      opts.max_memory ? "partitioned" : "in memory",
+      assembly.unitigs().size(), length, missing);
+
+    return missing;
+  }
+
+}
+
+int main(int argc, char** argv) {
+  ::std::size_t const genome_size = argc > 1 ? ::std::stoul(argv[1]) : 1'000'000;
+  ::std::size_t const read_length = argc > 2 ? ::std::stoul(argv[2]) : 10'000;
+
+  if (read_length < 4 || read_length > genome_size) {
+    ::mdbg::terminate("usage: example_assemble [genome_size] [read_length]");
+  }
+
+  auto const genome = ::mdbg::sim::random_genome(genome_size, 42);
+
+  // reads overlap by three quarters of their length
+  ::std::string bases;
+  ::std::vector<::std::size_t> ends;
+
+  for (::std::size_t begin = 0; begin + read_length <= genome_size; begin += read_length / 4) {
+    auto const read = ::std::string_view{genome}.substr(begin, read_length);
+    bases += ends.size() % 2 ? reverse_complement(read) : ::std::string{read};
+    ends.push_back(bases.size());
+  }
+
+  ::mdbg::command_line_options opts{};
+  opts.k = 20;
+  opts.l = 14;
+  opts.d = 0.01;
+
+  auto missing = assemble(opts, genome, bases, ends);
+
+  auto const directory = ::std::filesystem::temp_directory_path() / "mdbg_example";
+  ::std::filesystem::create_directories(directory);
+
+  opts.max_memory = bases.size();
+  opts.sequences = true;
+  opts.output_prefix = (directory / "assembly").string();
+  missing += assemble(opts, genome, bases, ends);
+
+  ::std::filesystem::remove_all(directory);
+
+  return missing ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <mdbg/huge_pages.hpp>
+
+#include <cstddef>
+#include <memory_resource>
+#include <utility>
+#include <vector>
+
+#include <tbb/enumerable_thread_specific.h>
+
+namespace mdbg {
+
+  // memory resource handing out memory from chunks owned by the calling
+  // thread, individual deallocations are ignored and everything is
+  // released at once when the arena is destroyed
+  //
+  // meant for objects living until the end of the run, reads and their
+  // minimizers, so that each costs a pointer bump instead of a malloc
+  // call contending with all other threads; chunks are huge pages when
+  // those are enabled
+  class arena : public ::std::pmr::memory_resource {
+   public:
+    ::std::size_t static constexpr chunk_size = 1 << 22;
+
+    arena() noexcept = default;
+
+    arena(arena const&) = delete;
+    arena& operator=(arena const&) = delete;
+
+    // bytes taken from the system by all threads
+    ::std::size_t reserved() const noexcept;
+
+   private:
+    using block_allocator = huge_pages::allocator<::std::byte>;
+
+    struct chunks {
+      ::std::vector<::std::pair<::std::byte*, ::std::size_t>> blocks;
+      ::std::byte* current = nullptr;
+      ::std::size_t left = 0;
+      ::std::size_t reserved = 0;
+
+      chunks() noexcept = default;
+
+      chunks(chunks const&) = delete;
+      chunks& operator=(chunks const&) = delete;
+
+      ~chunks() {
+        for (auto const& [block, size] : blocks) {
+          block_allocator{}.deallocate(block, size);
+        }
+      }
+    };
+
+    ::tbb::enumerable_thread_specific<chunks> local;
+
+    void* do_allocate(::std::size_t bytes, ::std::size_t alignment) override;
+
+    void do_deallocate(void*, ::std::size_t, ::std::size_t) noexcept override {}
+
+    bool do_is_equal(
+      ::std::pmr::memory_resource const& other
+    ) const noexcept override {
+      return this == &other;
+    }
+  };
+
+}
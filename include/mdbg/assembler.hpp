@@ -0,0 +1,198 @@
+#pragma once
+
+#include <mdbg/opt.hpp>
+#include <mdbg/containment.hpp>
+#include <mdbg/minimizers.hpp>
+#include <mdbg/graph/cleanup.hpp>
+#include <mdbg/graph/construction.hpp>
+#include <mdbg/graph/incremental.hpp>
+#include <mdbg/graph/partition.hpp>
+#include <mdbg/graph/serialization.hpp>
+#include <mdbg/graph/simplification.hpp>
+
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <ostream>
+#include <string_view>
+#include <vector>
+
+namespace mdbg {
+
+  // called from the workers for every read whose minimizers were
+  // detected and for every read added to the graph
+  struct assembly_progress {
+    ::std::function<void()> detected = [] {};
+    ::std::function<void()> constructed = [] {};
+  };
+
+  struct load_stats {
+    double detection_task_ms;
+    double construction_task_ms;
+    ::std::size_t read_batches;
+    ::std::size_t bases;
+    ::std::size_t arena_bytes;
+
+    // windows merged into thread local batches, and the ones among them
+    // whose node was already in the batch
+    ::std::size_t batch_windows;
+    ::std::size_t batch_hits;
+  };
+
+  // called by finish as it works on the graph: 'begin' with the name of
+  // each step before it runs and 'end' after it, followed by the hook
+  // reporting on the step
+  struct assembly_hooks {
+    ::std::function<void(char const*)> begin = [](char const*) {};
+    ::std::function<void()> end = [] {};
+
+    // with opts.max_memory, in place of the steps below up to simplify
+    ::std::function<void(graph::partition_stats const&)> partitioned =
+      [](graph::partition_stats const&) {};
+
+    // the whole graph, before anything is removed from it
+    ::std::function<void(graph::de_bruijn_graph_t const&)> constructed =
+      [](graph::de_bruijn_graph_t const&) {};
+
+    // nodes removed with an abundance below opts.min_abundance
+    ::std::function<void(::std::size_t)> filtered = [](::std::size_t) {};
+
+    // after resume, how much of the saved unitigs was walked again
+    ::std::function<void(graph::incremental_stats const&)> recomputed =
+      [](graph::incremental_stats const&) {};
+
+    ::std::function<void(graph::simplified_graph_t const&)> simplified =
+      [](graph::simplified_graph_t const&) {};
+
+    // with the unitigs that are left
+    ::std::function<void(
+      graph::cleanup_stats const&,
+      graph::simplified_graph_t const&
+    )> cleaned =
+      [](graph::cleanup_stats const&, graph::simplified_graph_t const&) {};
+  };
+
+  class assembly;
+
+  // in process assembly
+  //
+  // reads are pushed one at a time or in batches and copied, they are
+  // numbered in the order they were pushed; while more are pushed the
+  // earlier ones are detected and constructed by tasks on the TBB
+  // workers, a batch of reads per task, as configured by 'opts' with
+  // their defaults resolved
+  //
+  // 'mdbg' drives the loading steps below one by one and the rest through
+  // the hooks of finish to report on each of them, other users push
+  // their reads and call finish
+  class assembler {
+   public:
+    explicit assembler(command_line_options const& opts) noexcept;
+
+    ~assembler();
+
+    assembler(assembler const&) = delete;
+    assembler& operator=(assembler const&) = delete;
+
+    // must be called before any push
+    void on_progress(assembly_progress progress) noexcept;
+
+    // continues a saved graph loaded into graph(): reads pushed from then
+    // on are numbered after the 'reads' it was built from and finish only
+    // walks again the 'unitigs' they touch, must be called before any push
+    void resume(::std::size_t const reads, graph::saved_unitigs_t unitigs) noexcept;
+
+    void push(::std::string_view const read) noexcept;
+
+    void push(::std::vector<::std::string_view> const& reads) noexcept;
+
+    // reads packed back to back in 'bases', read i ending at ends[i]
+    void push(
+      ::std::string_view const bases,
+      ::std::vector<::std::size_t> const& ends
+    ) noexcept;
+
+    // waits until all pushed reads are detected and, unless they are to
+    // be checked for containment first, constructed
+    void wait() noexcept;
+
+    // with opts.remove_contained, the reads are only constructed once
+    // all of them are known: flags the redundant ones among them, then
+    // constructs the rest
+    ::std::vector<bool> find_redundant(containment_stats& stats) const noexcept;
+
+    void construct(::std::vector<bool> const& redundant) noexcept;
+
+    // merges what is left in the thread local batches into the graph
+    void flush() noexcept;
+
+    // runs the steps above that were not run yet, then filters,
+    // simplifies and cleans up the graph as configured; with
+    // opts.partitions > 1 the graph is left unsimplified for 'mdbg merge'
+    // instead; the assembler is left empty
+    assembly finish(assembly_hooks const& hooks = {}) noexcept;
+
+    load_stats stats() const noexcept;
+
+    // NUMA nodes the work is spread over, 0 without opts.numa
+    ::std::size_t numa_nodes() const noexcept;
+
+    ::std::size_t reads() const noexcept;
+
+    // the i-th pushed read, whatever resume numbers it
+    ::std::string_view read(::std::size_t const i) const noexcept;
+
+    read_minimizers_t const& read_minimizers(::std::size_t const i) const noexcept;
+
+    graph::de_bruijn_graph_t& graph() noexcept;
+
+   private:
+    struct state;
+    ::std::unique_ptr<state> self;
+
+    friend class assembly;
+  };
+
+  // unitigs of an assembly, spelled from the reads it was built from
+  // without copying them
+  class assembly {
+   public:
+    using unitig = graph::simplified_graph_t::value_type;
+
+    explicit assembly(::std::unique_ptr<assembler::state> self) noexcept;
+
+    ~assembly();
+
+    assembly(assembly&&) noexcept;
+    assembly& operator=(assembly&&) noexcept;
+
+    graph::simplified_graph_t const& unitigs() const noexcept;
+
+    graph::de_bruijn_graph_t const& graph() const noexcept;
+
+    ::std::size_t length(unitig const& u) const noexcept;
+
+    // calls f(bases, reverse_complement) with the pieces of reads that
+    // spell the unitig in order, reversed and complemented when set;
+    // with opts.max_memory the bases are only kept with opts.sequences,
+    // and never for the reads of a saved graph
+    template<typename F>
+    void for_each_piece(unitig const& u, F&& f) const noexcept {
+      auto const& nodes = u.second;
+      for (::std::size_t i = 0; i < nodes.size(); ++i) {
+        auto const piece = graph::span(nodes[i], i == 0, options());
+        f(read(piece.read).substr(piece.offset, piece.length), piece.reverse_complement);
+      }
+    }
+
+    void write_gfa(::std::ostream& out) const noexcept;
+
+   private:
+    command_line_options const& options() const noexcept;
+    ::std::string_view read(::std::size_t const i) const noexcept;
+
+    ::std::unique_ptr<assembler::state> self;
+  };
+
+}
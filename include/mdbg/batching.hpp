@@ -0,0 +1,33 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+
+namespace mdbg {
+
+  // size in bases of the read batches handed to detection and
+  // construction tasks
+  //
+  // a batch closes once it holds the target number of bases, so short
+  // reads share the cost of spawning a task while long ones get a task
+  // of their own and spread evenly over the threads; the target starts
+  // small so that all threads get work while the input is still being
+  // parsed and doubles with every batch up to max_bases
+  class batch_target {
+   public:
+    ::std::size_t static constexpr min_bases = ::std::size_t{1} << 16;
+    ::std::size_t static constexpr max_bases = ::std::size_t{1} << 22;
+
+    ::std::size_t bases() const noexcept {
+      return current;
+    }
+
+    void next() noexcept {
+      current = ::std::min(current * 2, max_bases);
+    }
+
+   private:
+    ::std::size_t current = min_bases;
+  };
+
+}
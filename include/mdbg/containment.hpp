@@ -0,0 +1,32 @@
+#pragma once
+
+#include <mdbg/minimizers.hpp>
+
+#include <cstddef>
+#include <functional>
+#include <vector>
+
+namespace mdbg {
+
+  struct containment_stats {
+    ::std::size_t duplicates = 0;
+    ::std::size_t contained = 0;
+  };
+
+  using read_minimizers_index_t =
+    ::std::function<read_minimizers_t const&(::std::size_t const)>;
+
+  // reads whose minimizers appear in the same order, on either strand,
+  // in another read; all their windows and edges are then part of the
+  // graph built from that read, so they only add to node abundances
+  //
+  // reads are visited from the most minimizers to the fewest and each
+  // one is looked up by its first minimizer among the ones kept so far,
+  // a duplicate keeps the first of its copies; returns a flag per read
+  ::std::vector<bool> find_redundant(
+    ::std::size_t const reads,
+    read_minimizers_index_t const& index,
+    containment_stats& stats
+  ) noexcept;
+
+}
@@ -0,0 +1,121 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+
+// hot path counters, compiled in only when MDBG_COUNTERS is defined
+// (cmake -DMDBG_COUNTERS=ON), otherwise every call below is an empty
+// inline function and costs nothing
+
+namespace mdbg::counters {
+
+#ifdef MDBG_COUNTERS
+  inline constexpr bool enabled = true;
+#else
+  inline constexpr bool enabled = false;
+#endif
+
+  enum class counter : ::std::size_t {
+    // graph.insert found an existing node
+    insert_hit,
+    // graph.insert created a new node
+    insert_miss,
+    // nanoseconds spent acquiring graph accessors
+    accessor_wait_ns,
+    // rehashes of a node's edge set, in the thread local batches
+    // and when merged into the shared graph
+    edge_set_resize,
+    // unitigs walked from both ends, the second walk being discarded
+    duplicate_unitig,
+    // nodes copied by discarded unitig walks
+    duplicate_unitig_nodes,
+    size
+  };
+
+  enum class histogram : ::std::size_t {
+    // nanoseconds per accessor acquisition
+    accessor_wait_ns,
+    // nodes per unitig
+    unitig_length,
+    size
+  };
+
+  // log2 buckets, the last one also holds everything larger
+  inline constexpr ::std::size_t histogram_buckets = 32;
+
+  // counters of a single thread, only ever written by their owner so
+  // updates are plain relaxed stores, readers may see slightly stale values
+  struct local_counters {
+    ::std::array<
+      ::std::atomic<::std::uint64_t>,
+      static_cast<::std::size_t>(counter::size)> values = {};
+
+    ::std::array<
+      ::std::array<::std::atomic<::std::uint64_t>, histogram_buckets>,
+      static_cast<::std::size_t>(histogram::size)> histograms = {};
+  };
+
+#ifdef MDBG_COUNTERS
+  local_counters& local() noexcept;
+
+  // sum of a counter over all threads
+  ::std::uint64_t total(counter const c) noexcept;
+
+  // prints all counters and histograms merged over threads
+  void print(FILE* out) noexcept;
+
+  inline void add(counter const c, ::std::uint64_t const n = 1) noexcept {
+    auto& value = local().values[static_cast<::std::size_t>(c)];
+    value.store(value.load(::std::memory_order_relaxed) + n, ::std::memory_order_relaxed);
+  }
+
+  inline void record(histogram const h, ::std::uint64_t const value) noexcept {
+    ::std::size_t bucket = 0;
+    while (bucket + 1 < histogram_buckets && (value >> (bucket + 1)) != 0) {
+      ++bucket;
+    }
+
+    auto& count = local().histograms[static_cast<::std::size_t>(h)][bucket];
+    count.store(count.load(::std::memory_order_relaxed) + 1, ::std::memory_order_relaxed);
+  }
+
+  // runs f and accounts the time spent as accessor wait time
+  template<typename F>
+  auto time_accessor(F&& f) noexcept {
+    auto const begin = ::std::chrono::steady_clock::now();
+    auto rv = f();
+    auto const ns = static_cast<::std::uint64_t>(
+      ::std::chrono::duration_cast<::std::chrono::nanoseconds>(
+        ::std::chrono::steady_clock::now() - begin).count());
+
+    add(counter::accessor_wait_ns, ns);
+    record(histogram::accessor_wait_ns, ns);
+    return rv;
+  }
+#else
+  inline ::std::uint64_t total(counter) noexcept { return 0; }
+  inline void print(FILE*) noexcept {}
+  inline void add(counter, ::std::uint64_t = 1) noexcept {}
+  inline void record(histogram, ::std::uint64_t) noexcept {}
+
+  template<typename F>
+  auto time_accessor(F&& f) noexcept {
+    return f();
+  }
+#endif
+
+  // counter readers usable as live table cells
+  template<counter C>
+  ::std::size_t read() noexcept {
+    return static_cast<::std::size_t>(total(C));
+  }
+
+  template<counter C>
+  ::std::size_t read_ms() noexcept {
+    return static_cast<::std::size_t>(total(C) / 1'000'000);
+  }
+
+}
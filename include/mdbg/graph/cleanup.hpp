@@ -0,0 +1,55 @@
+#pragma once
+
+#include <mdbg/graph/simplification.hpp>
+#include <mdbg/opt.hpp>
+
+namespace mdbg::graph {
+
+  // the passes below find structures in the simplified graph and remove
+  // the corresponding nodes or edges from the de Bruijn graph, the
+  // simplified graph has to be rebuilt afterwards
+  //
+  // each returns the number of removed unitigs or links
+
+  // removes unitigs shorter than max_length that have one dead end
+  // and whose other end joins a node reachable through another path;
+  // where all paths into a node are such tips, the longest one stays
+  ::std::size_t clip_tips(
+    de_bruijn_graph_t& dbg,
+    simplified_graph_t const& graph,
+    ::std::size_t const max_length,
+    command_line_options const& opts
+  ) noexcept;
+
+  // removes unitigs shorter than max_length with a single predecessor
+  // and successor when another path of at most max_length bases joins
+  // the two through unitigs with a higher mean node count
+  ::std::size_t pop_bubbles(
+    de_bruijn_graph_t& dbg,
+    simplified_graph_t const& graph,
+    ::std::size_t const max_length,
+    command_line_options const& opts
+  ) noexcept;
+
+  // removes links from a segment to itself and every link but the first
+  // one between the same two segments, regardless of orientation
+  ::std::size_t break_loops(
+    de_bruijn_graph_t& dbg,
+    simplified_graph_t const& graph
+  ) noexcept;
+
+  struct cleanup_stats {
+    ::std::size_t tips = 0;
+    ::std::size_t bubbles = 0;
+    ::std::size_t loops = 0;
+  };
+
+  // runs the passes enabled in opts until the graph stops changing,
+  // re-unitigging after each one that removed something
+  cleanup_stats clean(
+    de_bruijn_graph_t& dbg,
+    simplified_graph_t& graph,
+    command_line_options const& opts
+  ) noexcept;
+
+}
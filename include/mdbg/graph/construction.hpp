@@ -5,14 +5,22 @@
 #include <mdbg/io.hpp>
 #include <mdbg/opt.hpp>
 #include <mdbg/hash.hpp>
+#include <mdbg/huge_pages.hpp>
 
 #include <tsl/robin_map.h>
 #include <tsl/robin_set.h>
 #include <tbb/concurrent_hash_map.h>
+#include <tbb/tbb_allocator.h>
 
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
 #include <functional>
+#include <limits>
+#include <memory>
 #include <optional>
 #include <ostream>
+#include <utility>
 
 namespace mdbg::graph {
 
@@ -20,9 +28,16 @@ namespace mdbg::graph {
 
     using minimizer_iter_t = read_minimizers_t::const_iterator;
     
+    // key of a node, a window of k - 1 minimizers
+    //
+    // cached_hash is the canonical hash of the window, the smaller of the
+    // hashes of the window read forward and backward; 'reverse' is set
+    // when the minimizers starting at 'minimizer' run in the opposite
+    // direction of the canonical orientation
     struct compact_minimizer {
       minimizer_iter_t minimizer;
-      ::mdbg::hash128 cached_hash;
+      ::mdbg::node_hash cached_hash;
+      bool reverse = false;
     };
 
     struct compact_minimizer_hash {
@@ -52,15 +67,111 @@ namespace mdbg::graph {
       }
     };
 
+    // node traversed in a given orientation
+    struct oriented_minimizer {
+      ::mdbg::node_hash cached_hash;
+      bool reverse = false;
+
+      oriented_minimizer flip() const noexcept {
+        return {cached_hash, !reverse};
+      }
+
+      compact_minimizer key() const noexcept {
+        return {{}, cached_hash, reverse};
+      }
+
+      friend bool operator==(
+        oriented_minimizer const& l, oriented_minimizer const& r
+      ) noexcept {
+        return l.cached_hash == r.cached_hash && l.reverse == r.reverse;
+      }
+
+      friend bool operator<(
+        oriented_minimizer const& l, oriented_minimizer const& r
+      ) noexcept {
+        return l.cached_hash < r.cached_hash
+          || (l.cached_hash == r.cached_hash && l.reverse < r.reverse);
+      }
+    };
+
+    struct oriented_minimizer_hash {
+      using value_type = oriented_minimizer;
+      ::std::size_t operator()(value_type const& m) const noexcept {
+        return m.cached_hash.collapse() ^ static_cast<::std::size_t>(m.reverse);
+      }
+    };
+
+    struct oriented_hash_eq {
+      using value_type = oriented_minimizer;
+      static ::std::size_t hash(value_type const& m) noexcept {
+        return oriented_minimizer_hash{}(m);
+      }
+      static bool equal(value_type const& l, value_type const& r) noexcept {
+        return l == r;
+      }
+    };
+
+    // edge leaving a node traversed in orientation 'from_reverse'
+    //
+    // every edge is stored on both of its nodes, the second copy being
+    // the same edge read on the opposite strand, which makes in degrees
+    // available as out degrees of the opposite orientation
+    struct dbg_edge {
+      bool from_reverse;
+      oriented_minimizer to;
+
+      friend bool operator==(dbg_edge const& l, dbg_edge const& r) noexcept {
+        return l.from_reverse == r.from_reverse && l.to == r.to;
+      }
+    };
+
+    struct dbg_edge_hash {
+      using value_type = dbg_edge;
+      ::std::size_t operator()(value_type const& e) const noexcept {
+        return oriented_minimizer_hash{}(e.to)
+          ^ (static_cast<::std::size_t>(e.from_reverse) << 1);
+      }
+    };
+
     struct dbg_node {
-      ::tsl::robin_set<
-        detail::compact_minimizer,
-        detail::compact_minimizer_hash,
-        detail::compact_minimizer_eq
-      > out_edges;
-
-      ::std::optional<compact_minimizer> last_in = ::std::nullopt;
-      bool fan_in = false;
+      ::tsl::robin_set<dbg_edge, dbg_edge_hash> edges;
+
+      // number of windows seen with this node, saturates
+      ::std::uint16_t count = 0;
+
+      void increment() noexcept {
+        if (count != ::std::numeric_limits<decltype(count)>::max()) {
+          ++count;
+        }
+      }
+
+      void merge(dbg_node const& other) noexcept {
+        edges.insert(other.edges.begin(), other.edges.end());
+        count = static_cast<decltype(count)>(::std::min<::std::size_t>(
+          ::std::size_t{count} + other.count,
+          ::std::numeric_limits<decltype(count)>::max()));
+      }
+
+      ::std::size_t out_degree(bool const reverse) const noexcept {
+        ::std::size_t rv = 0;
+        for (auto const& edge : edges) {
+          rv += edge.from_reverse == reverse;
+        }
+        return rv;
+      }
+
+      ::std::size_t in_degree(bool const reverse) const noexcept {
+        return out_degree(!reverse);
+      }
+
+      template<typename F>
+      void for_each_out_edge(bool const reverse, F&& f) const noexcept {
+        for (auto const& edge : edges) {
+          if (edge.from_reverse == reverse) {
+            f(edge.to);
+          }
+        }
+      }
     };
 
   }
@@ -81,12 +192,32 @@ namespace mdbg::graph {
       detail::compact_minimizer_eq
     >;
 
+  template<typename V>
+  using oriented_minimizer_map_t =
+    ::tsl::robin_map<
+      detail::oriented_minimizer,
+      V,
+      detail::oriented_minimizer_hash
+    >;
+
+  // bucket arrays of the graph are backed by huge pages when enabled
   template<typename V>
   using concurrent_minimizer_map_t = 
     ::tbb::concurrent_hash_map<
       detail::compact_minimizer,
       V,
-      detail::compact_hash_eq
+      detail::compact_hash_eq,
+      huge_pages::allocator<
+        ::std::pair<detail::compact_minimizer const, V>,
+        ::tbb::tbb_allocator<::std::pair<detail::compact_minimizer const, V>>>
+    >;
+
+  template<typename V>
+  using concurrent_oriented_map_t =
+    ::tbb::concurrent_hash_map<
+      detail::oriented_minimizer,
+      V,
+      detail::oriented_hash_eq
     >;
 
   using concurrent_de_bruijn_graph_t = 
@@ -94,12 +225,159 @@ namespace mdbg::graph {
 
   using de_bruijn_graph_t = concurrent_de_bruijn_graph_t;
 
+  // partition out of 'partitions' a node with the given hash belongs to
+  inline ::std::size_t partition_of(
+    ::mdbg::node_hash const& hash,
+    ::std::size_t const partitions
+  ) noexcept {
+    return (hash.collapse() >> 32) % partitions;
+  }
+
+  // calls f with every window of k - 1 minimizers of a read in order,
+  // keyed by the smaller of its forward and reversed hash
+  //
+  // R is the shift_range_of(k - 1), the overload below picks it
+  template<::mdbg::shift_range R, typename F>
+  void for_each_window(
+    read_minimizers_t const& read_minimizers,
+    command_line_options const& opts,
+    F&& f
+  ) noexcept {
+    if (opts.k < 3) {
+      ::mdbg::terminate("k should be at least 3");
+    }
+    auto const overlap_length = opts.k - 1;
+
+    if (read_minimizers.size() < opts.k) {
+      return;
+    }
+
+    // hashes of the current window read forward and backward
+    ::mdbg::node_hash forward, reversed;
+
+    for (::std::size_t i = 0; i < overlap_length; ++i) {
+      forward.advance(read_minimizers[i].minimizer);
+      reversed.advance(read_minimizers[overlap_length - 1 - i].minimizer);
+    }
+
+    auto const canonical = [&forward, &reversed](auto const iter) {
+      return reversed < forward
+        ? detail::compact_minimizer{iter, reversed, true}
+        : detail::compact_minimizer{iter, forward, false};
+    };
+
+    f(canonical(read_minimizers.begin()));
+    
+    for (::std::size_t i = 1; 
+         i < read_minimizers.size() - overlap_length + 1; ++i) {
+
+      auto const in  = read_minimizers[i + overlap_length - 1].minimizer;
+      auto const out = read_minimizers[i - 1].minimizer;
+
+      forward.rotate<R>(in, out, overlap_length);
+      reversed.rotate_reversed<R>(in, out, overlap_length);
+
+      f(canonical(read_minimizers.begin() + static_cast<::std::ptrdiff_t>(i)));
+    }
+  }
+
+  template<typename F>
+  void for_each_window(
+    read_minimizers_t const& read_minimizers,
+    command_line_options const& opts,
+    F&& f
+  ) noexcept {
+    using ::mdbg::shift_range;
+
+    switch (::mdbg::shift_range_of(opts.k - 1)) {
+      case shift_range::below_64:
+        return for_each_window<shift_range::below_64>(
+          read_minimizers, opts, ::std::forward<F>(f));
+      case shift_range::above_64:
+        return for_each_window<shift_range::above_64>(
+          read_minimizers, opts, ::std::forward<F>(f));
+      default:
+        return for_each_window<shift_range::any>(
+          read_minimizers, opts, ::std::forward<F>(f));
+    }
+  }
+
   void construct(
     de_bruijn_graph_t& graph,
     read_minimizers_t const& read_minimizers,
     command_line_options const& opts
   ) noexcept;
 
+  // windows compared with the node they were merged into, and among them
+  // the ones whose minimizers differ from the node's despite equal hashes
+  struct collision_stats {
+    ::std::size_t checked = 0;
+    ::std::size_t collisions = 0;
+  };
+
+  // from then on the opts.check_collisions fraction of windows merged into
+  // an existing node, sampled by hash, is compared minimizer by minimizer
+  // with the window the node was created from
+  void check_collisions(command_line_options const& opts) noexcept;
+
+  collision_stats collisions() noexcept;
+
+  // colliding pairs expected among the given number of distinct nodes
+  inline double expected_collisions(::std::size_t const nodes) noexcept {
+    auto const n = static_cast<double>(nodes);
+    return n * n / 2 / ::std::pow(2.0, 8 * sizeof(::mdbg::node_hash));
+  }
+
+  // thread local staging area for construction
+  //
+  // at high coverage the same windows are inserted over and over, a batch
+  // merges them without any locking so that only one insertion per
+  // distinct window reaches the shared graph when it is flushed
+  struct construction_batch {
+    // number of distinct windows after which a batch should be flushed
+    ::std::size_t static constexpr capacity = 1 << 12;
+
+    minimizer_map_t<detail::dbg_node> nodes;
+
+    // stands in for nodes of other partitions with --partition
+    detail::dbg_node foreign;
+
+    // with --add-to, every node the batch merged into the graph
+    ::std::optional<minimizer_set_t> touched;
+
+    // windows merged into the batch, and among them the ones that were
+    // already in it and so did not cost an insertion into the graph
+    ::std::size_t windows = 0;
+    ::std::size_t hits = 0;
+
+    bool full() const noexcept {
+      return nodes.size() >= capacity;
+    }
+  };
+
+  void construct(
+    construction_batch& batch,
+    read_minimizers_t const& read_minimizers,
+    command_line_options const& opts
+  ) noexcept;
+
+  // merges the batch into the graph and empties it
+  void flush(de_bruijn_graph_t& graph, construction_batch& batch) noexcept;
+
+  using batch_nodes_t = minimizer_map_t<detail::dbg_node>;
+
+  // empties the batch handing out its nodes, to be merged into the graph
+  // in parts by flush below, possibly on other threads
+  ::std::shared_ptr<batch_nodes_t const> detach(construction_batch& batch) noexcept;
+
+  // merges the nodes falling into partition 'part' out of 'parts'
+  void flush(
+    de_bruijn_graph_t& graph,
+    batch_nodes_t const& nodes,
+    ::std::size_t const part,
+    ::std::size_t const parts
+  ) noexcept;
+
   void construct(
     de_bruijn_graph_t& graph, 
     ::std::vector<read_minimizers_t>::const_iterator begin,
@@ -107,16 +385,18 @@ namespace mdbg::graph {
     command_line_options const& opts
   ) noexcept;
 
+  // number of edges, mirrored copies are counted once
+  ::std::size_t count_edges(de_bruijn_graph_t const& graph) noexcept;
+
   inline ::std::size_t calculate_length(
     decltype(detail::compact_minimizer::minimizer) begin,
-    ::std::size_t const length,
-    ::std::size_t const
+    ::std::size_t const length
   ) noexcept {
       // calculate the length in bases for
-      // 'length' minimizers, without including the last minimizer's
-      // own length l
+      // 'length' minimizers, from the start of the first one to the
+      // end of the last one
       auto const end = begin + static_cast<::std::int64_t>(length) - 1;
-      return end->offset - begin->offset;
+      return end->offset + end->length - begin->offset;
   }
 
 }
@@ -0,0 +1,30 @@
+#pragma once
+
+#include <mdbg/graph/construction.hpp>
+#include <mdbg/graph/serialization.hpp>
+#include <mdbg/graph/simplification.hpp>
+
+namespace mdbg::graph {
+
+  struct incremental_stats {
+    ::std::size_t touched;
+    ::std::size_t dirty;
+    ::std::size_t kept;
+    ::std::size_t recomputed;
+  };
+
+  // simplifies a graph that grew since 'previous' was computed from it
+  //
+  // adding reads only adds nodes and edges, so a previous unitig stays
+  // valid unless one of its nodes or one of their neighbours was touched;
+  // those are kept as they are and the others are walked again over the
+  // graph from the nodes around the touched ones, starting where
+  // simplify would start, without visiting the rest of the graph
+  simplified_graph_t simplify_incremental(
+    de_bruijn_graph_t const& dbg,
+    saved_unitigs_t const& previous,
+    minimizer_set_t const& touched,
+    incremental_stats& stats
+  ) noexcept;
+
+}
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <mdbg/graph/construction.hpp>
+#include <mdbg/hash.hpp>
+#include <mdbg/huge_pages.hpp>
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+
+namespace mdbg::graph {
+
+  // read only open addressing index over the nodes of a finished
+  // de Bruijn graph
+  //
+  // lookups through tbb::concurrent_hash_map take a bucket lock even
+  // when the map no longer changes; this index is probed without any
+  // locking, one slot per cache line touched in the common case
+  //
+  // the graph must not change while the index is in use
+  class node_index {
+   public:
+    using value_type = de_bruijn_graph_t::value_type;
+
+    explicit node_index(de_bruijn_graph_t const& dbg) noexcept;
+
+    value_type const* find(::mdbg::node_hash const& key) const noexcept {
+      auto const hash = key.collapse();
+
+      for (auto i = hash & mask;; i = (i + 1) & mask) {
+        auto const* node = slots[i].node.load(::std::memory_order_relaxed);
+        if (node == nullptr) {
+          return nullptr;
+        }
+        if (slots[i].hash == hash && node->first.cached_hash == key) {
+          return node;
+        }
+      }
+    }
+
+    ::std::size_t capacity() const noexcept {
+      return mask + 1;
+    }
+
+   private:
+    struct slot {
+      ::std::atomic<value_type const*> node = nullptr;
+      ::std::uint64_t hash = 0;
+    };
+
+    using slot_allocator = huge_pages::allocator<slot>;
+
+    struct release_slots {
+      ::std::size_t capacity;
+
+      void operator()(slot* const ptr) const noexcept {
+        slot_allocator{}.deallocate(ptr, capacity);
+      }
+    };
+
+    ::std::unique_ptr<slot[], release_slots> slots;
+    ::std::uint64_t mask;
+  };
+
+}
@@ -0,0 +1,134 @@
+#pragma once
+
+#include <mdbg/graph/construction.hpp>
+#include <mdbg/graph/simplification.hpp>
+#include <mdbg/hash.hpp>
+#include <mdbg/opt.hpp>
+
+#include <array>
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace mdbg::graph {
+
+  namespace detail {
+
+    // one window of a read as streamed to disk, together with the
+    // edges it adds to its node
+    struct window_record {
+      ::mdbg::node_hash hash;
+      ::mdbg::node_hash prev;
+      ::mdbg::node_hash next;
+
+      // position of the window's first minimizer
+      ::std::uint32_t read;
+      ::std::uint32_t index;
+
+      // window is stored reversed, has a predecessor/successor
+      // and how they are oriented
+      ::std::uint8_t flags;
+
+      static constexpr ::std::uint8_t reverse = 1 << 0;
+      static constexpr ::std::uint8_t has_prev = 1 << 1;
+      static constexpr ::std::uint8_t prev_reverse = 1 << 2;
+      static constexpr ::std::uint8_t has_next = 1 << 3;
+      static constexpr ::std::uint8_t next_reverse = 1 << 4;
+    };
+
+  }
+
+  // windows of all reads spread over on disk buckets by node hash
+  //
+  // construction streams windows here instead of into a graph, the
+  // buckets are later grouped into partitions small enough to be built
+  // as a graph in memory one at a time
+  class partitioned_windows {
+   public:
+    ::std::size_t static constexpr buckets = 256;
+
+    explicit partitioned_windows(::std::filesystem::path directory) noexcept;
+    ~partitioned_windows();
+
+    partitioned_windows(partitioned_windows const&) = delete;
+    partitioned_windows& operator=(partitioned_windows const&) = delete;
+
+    static ::std::size_t bucket_of(::mdbg::node_hash const& hash) noexcept {
+      return partition_of(hash, buckets);
+    }
+
+    void write(
+      ::std::size_t const bucket,
+      detail::window_record const* records,
+      ::std::size_t const count
+    ) noexcept;
+
+    // number of records in a bucket, all writes have to be done
+    ::std::size_t size(::std::size_t const bucket) noexcept;
+
+    ::std::vector<detail::window_record> read(::std::size_t const bucket) noexcept;
+
+    ::std::filesystem::path const& path() const noexcept {
+      return directory;
+    }
+
+   private:
+    ::std::filesystem::path directory;
+    ::std::array<FILE*, buckets> files;
+    ::std::unique_ptr<::std::mutex[]> locks;
+  };
+
+  // thread local staging area, records are written out per bucket
+  // once enough of them have gathered
+  struct partition_batch {
+    ::std::size_t static constexpr capacity = 1 << 10;
+
+    ::std::array<
+      ::std::vector<detail::window_record>,
+      partitioned_windows::buckets> records;
+  };
+
+  void construct(
+    partitioned_windows& windows,
+    partition_batch& batch,
+    read_minimizers_t const& read_minimizers,
+    command_line_options const& opts
+  ) noexcept;
+
+  // writes out everything left in the batch
+  void flush(partitioned_windows& windows, partition_batch& batch) noexcept;
+
+  using read_minimizers_index_t =
+    ::std::function<read_minimizers_t const&(::std::size_t const)>;
+
+  struct partition_stats {
+    ::std::size_t partitions;
+    ::std::size_t nodes;
+    ::std::size_t removed;
+    ::std::size_t fragments;
+
+    // partitions whose single bucket alone did not fit the budget
+    ::std::size_t oversized;
+  };
+
+  // builds and simplifies the buckets a few at a time, keeping the
+  // estimated size of each partition's graph within 'max_memory' bytes
+  // minus what the process already holds, then stitches unitigs cut at
+  // partition boundaries; nodes below opts.min_abundance are dropped
+  // bucket by bucket
+  //
+  // the unitigs of finished partitions are held without the edges of
+  // their inner nodes until they are stitched
+  simplified_graph_t assemble_partitioned(
+    partitioned_windows& windows,
+    read_minimizers_index_t const& index,
+    ::std::size_t const max_memory,
+    command_line_options const& opts,
+    partition_stats& stats
+  ) noexcept;
+
+}
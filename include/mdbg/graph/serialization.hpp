@@ -0,0 +1,85 @@
+#pragma once
+
+#include <mdbg/graph/construction.hpp>
+#include <mdbg/graph/simplification.hpp>
+#include <mdbg/opt.hpp>
+
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <vector>
+
+namespace mdbg::graph {
+
+  // binary graph files keep every node together with the window of
+  // k - 1 minimizers it was keyed by, so that they can be loaded and
+  // spelled without detecting minimizers on the reads again
+  struct graph_header {
+    ::std::uint64_t k;
+    ::std::uint64_t l;
+    double d;
+    ::std::uint64_t scheme;
+    ::std::uint64_t syncmer_s;
+    ::std::uint64_t max_gap;
+    ::std::uint64_t hpc;
+    ::std::uint64_t partition;
+    ::std::uint64_t partitions;
+
+    // fraction of the input reads kept by --target-coverage
+    double sample;
+
+    // reads the graph was built from, later reads are numbered after them
+    ::std::uint64_t reads;
+    ::std::uint64_t nodes;
+  };
+
+  // the graphs were built from minimizers picked the same way
+  inline bool same_minimizers(graph_header const& l, graph_header const& r) noexcept {
+    return l.k == r.k && l.l == r.l && l.d == r.d && l.scheme == r.scheme
+      && l.syncmer_s == r.syncmer_s && l.max_gap == r.max_gap && l.hpc == r.hpc;
+  }
+
+  // path of the file holding partition opts.partition
+  ::std::string partition_path(
+    ::std::string const& output_prefix,
+    command_line_options const& opts
+  ) noexcept;
+
+  void save_graph(
+    ::std::string const& path,
+    de_bruijn_graph_t const& dbg,
+    ::std::size_t const reads,
+    command_line_options const& opts
+  ) noexcept;
+
+  graph_header read_header(::std::string const& path) noexcept;
+
+  // inserts the nodes of a saved graph into 'dbg', merging nodes it
+  // already holds; their windows are kept in a new entry of 'windows',
+  // which has to outlive the graph
+  //
+  // nodes with edges into other partitions are appended to 'boundary'
+  graph_header load_graph(
+    ::std::string const& path,
+    de_bruijn_graph_t& dbg,
+    ::std::deque<read_minimizers_t>& windows,
+    ::std::vector<detail::compact_minimizer>& boundary
+  ) noexcept;
+
+  // unitigs as the oriented nodes they pass through, without the nodes
+  using saved_unitigs_t = ::std::vector<::std::vector<detail::oriented_minimizer>>;
+
+  void save_unitigs(
+    ::std::string const& path,
+    simplified_graph_t const& simplified,
+    command_line_options const& opts
+  ) noexcept;
+
+  // terminates unless the unitigs were built with the same k, l, d
+  // and minimum abundance as given in 'opts'
+  saved_unitigs_t load_unitigs(
+    ::std::string const& path,
+    command_line_options const& opts
+  ) noexcept;
+
+}
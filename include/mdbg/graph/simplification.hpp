@@ -4,15 +4,161 @@
 
 #include <vector>
 #include <functional>
+#include <string_view>
 
 namespace mdbg::graph {
 
+  // node of a unitig together with the orientation it is traversed in
+  struct unitig_node {
+    de_bruijn_graph_t::value_type node;
+    bool reverse;
+  };
+
+  // unitigs keyed by their oriented starting node, only one of the two
+  // strands of every unitig is kept
   using simplified_graph_t =
-    concurrent_minimizer_map_t<::std::vector<de_bruijn_graph_t::value_type>>;
+    concurrent_oriented_map_t<::std::vector<unitig_node>>;
+
+  // removes the given nodes along with the mirrored copies
+  // of their edges held by the neighbouring nodes
+  void remove_nodes(
+    de_bruijn_graph_t& dbg,
+    ::std::vector<detail::compact_minimizer> const& nodes
+  ) noexcept;
+
+  // removes the edge between the oriented nodes in both directions
+  void remove_edge(
+    de_bruijn_graph_t& dbg,
+    detail::oriented_minimizer const& from,
+    detail::oriented_minimizer const& to
+  ) noexcept;
+
+  // removes edges of the given nodes leading to nodes not in the graph,
+  // returns the number of removed edges
+  ::std::size_t remove_dangling_edges(
+    de_bruijn_graph_t& dbg,
+    ::std::vector<detail::compact_minimizer> const& nodes
+  ) noexcept;
+
+  // removes nodes with a count below min_abundance along with
+  // their edges, returns the number of removed nodes
+  ::std::size_t remove_low_abundance(
+    de_bruijn_graph_t& dbg,
+    ::std::size_t const min_abundance
+  ) noexcept;
 
   simplified_graph_t simplify(de_bruijn_graph_t const& dbg) noexcept;
 
-  using sequence_index_t = ::std::function<::std::string const&(::std::size_t const)>;
+  // simplifies a graph holding one partition of all nodes, edges leading
+  // out of it are kept but walks stop there, so unitigs crossing
+  // partitions come out cut into fragments at every crossing
+  simplified_graph_t simplify_partition(de_bruijn_graph_t const& dbg) noexcept;
+
+  // walks the unitig from an oriented node for as long as the next node
+  // is the only successor and has a single predecessor, 'find' returns
+  // the node of a hash or nullptr when it is not part of the walked graph
+  template<typename Find>
+  simplified_graph_t::mapped_type walk_unitig(
+    Find const& find,
+    detail::oriented_minimizer const& starting_minimizer
+  ) noexcept {
+    de_bruijn_graph_t::value_type const* current_node =
+      find(starting_minimizer.cached_hash);
+    auto reverse = starting_minimizer.reverse;
+
+    simplified_graph_t::mapped_type rv;
+    
+    // = \       / =
+    // = = ===== = =
+    // = /       \ =
+    //   X       X
+    for (;;) {
+      detail::oriented_minimizer next;
+      bool extend = current_node->second.out_degree(reverse) == 1;
+
+      if (extend) {
+        current_node->second.for_each_out_edge(
+          reverse, [&next](auto const& to) { next = to; });
+
+        // loops back onto the start, possibly on the other strand
+        extend = next.cached_hash != starting_minimizer.cached_hash;
+      }
+
+      rv.push_back({*current_node, reverse});
+
+      if (!extend) {
+        break;
+      }
+
+      current_node = find(next.cached_hash);
+      
+      // outside of the walked graph
+      if (current_node == nullptr
+          || current_node->second.in_degree(next.reverse) != 1) {
+        break;
+      }
+
+      reverse = next.reverse;
+    }
+
+    return rv;
+  }
+
+  // bases of a read spelled by a node of a unitig
+  struct node_span {
+    ::std::size_t read;
+    ::std::size_t offset;
+    ::std::size_t length;
+    bool reverse_complement;
+  };
+
+  node_span span(
+    unitig_node const& node,
+    bool const first,
+    command_line_options const& opts
+  ) noexcept;
+
+  ::std::size_t unitig_length(
+    simplified_graph_t::mapped_type const& unitig_nodes,
+    command_line_options const& opts
+  ) noexcept;
+
+  // length in bases shared by a node and its successors
+  ::std::size_t overlap_length(
+    unitig_node const& tail,
+    bool const reverse,
+    command_line_options const& opts
+  ) noexcept;
+
+  // oriented node -> (segment, segment is traversed reversed)
+  // every segment can be entered through its first node, or through 
+  // its last node on the opposite strand
+  using segment_index_t = 
+    oriented_minimizer_map_t<::std::pair<::std::size_t, bool>>;
+
+  // segments are numbered in iteration order of the graph
+  segment_index_t index_segments(simplified_graph_t const& graph) noexcept;
+
+  struct segment_link {
+    ::std::size_t from;
+    bool from_reverse;
+    ::std::size_t to;
+    bool to_reverse;
+
+    // node and edge of the de Bruijn graph the link was derived from
+    unitig_node const& tail;
+    detail::oriented_minimizer tail_node;
+    detail::oriented_minimizer target;
+  };
+
+  // visits every link once, in only one of its two equivalent orientations
+  void for_each_link(
+    simplified_graph_t const& graph,
+    segment_index_t const& segments,
+    ::std::function<void(segment_link const&)> const& f
+  ) noexcept;
+
+  using sequence_index_t = ::std::function<::std::string_view(::std::size_t const)>;
 
   void write_gfa(
     ::std::ostream& out,
@@ -5,7 +5,26 @@
 
 namespace mdbg {
 
+  // range the shifts done by rotate and rotate_reversed fall into, known
+  // ranges let mix drop the branches on the shift
+  enum class shift_range { any, below_64, above_64 };
+
+  // for windows of 'length' values
+  inline constexpr shift_range shift_range_of(::std::size_t const length) noexcept {
+    if (length >= 2 && length < 64) {
+      return shift_range::below_64;
+    }
+    if (length > 65 && length < 128) {
+      return shift_range::above_64;
+    }
+    return shift_range::any;
+  }
+
   // 128 bit hash value meant for use as a rolling hash
+  //
+  // values are combined using 128 bit rotations so that the hash
+  // can be rolled in both directions, which is what makes it possible
+  // to keep the hash of a reversed window alongside the forward one
   struct hash128 {
     ::std::uint64_t lower = 0;
     ::std::uint64_t upper = 0;
@@ -18,6 +37,10 @@ namespace mdbg {
       return (l.lower != r.lower) + (l.upper != r.upper);
     }
 
+    friend bool operator<(hash128 const& l, hash128 const& r) noexcept {
+      return l.upper < r.upper || (l.upper == r.upper && l.lower < r.lower);
+    }
+
     friend ::std::ostream& operator<<(::std::ostream& out, hash128 const& h) noexcept {
       return out << h.lower << " " << h.upper;
     }
@@ -42,11 +65,42 @@ namespace mdbg {
       return h;
     }
 
+    // xors 'value' rotated left by 'shift' % 128 bits into the hash
+    template<shift_range R = shift_range::any>
+    void mix(::std::uint64_t const value, ::std::size_t shift) noexcept {
+      if constexpr (R == shift_range::below_64) {
+        lower ^= value << shift;
+        upper ^= value >> (64 - shift);
+        return;
+      } else if constexpr (R == shift_range::above_64) {
+        upper ^= value << (shift - 64);
+        lower ^= value >> (128 - shift);
+        return;
+      }
+
+      shift %= 128;
+
+      if (shift == 0) {
+        lower ^= value;
+      } else if (shift < 64) {
+        lower ^= value << shift;
+        upper ^= value >> (64 - shift);
+      } else if (shift == 64) { // shifting by 64 bits or more == UB
+        upper ^= value;
+      } else {
+        upper ^= value << (shift - 64);
+        lower ^= value >> (128 - shift);
+      }
+    }
+
     void advance(::std::uint64_t const in) noexcept {
+      auto const carry = upper >> 63;
+
       upper <<= 1;
       upper |= lower >> 63;
 
       lower <<= 1;
+      lower |= carry;
       lower ^= in;
     }
 
@@ -59,20 +113,121 @@ namespace mdbg {
       }
     }
 
+    // slides a window of 'length' values one step forward, R is the
+    // shift_range_of(length) when known at compile time
+    template<shift_range R = shift_range::any>
     void rotate(
       ::std::uint64_t const in,
       ::std::uint64_t const out,
       ::std::size_t const length
     ) noexcept {
       advance(in);
+      mix<R>(out, length);
+    }
+
+    // counterpart of rotate for the hash of the reversed window,
+    // i.e. the hash that would be obtained by constructing hash128
+    // from reverse iterators over the same window
+    template<shift_range R = shift_range::any>
+    void rotate_reversed(
+      ::std::uint64_t const in,
+      ::std::uint64_t const out,
+      ::std::size_t const length
+    ) noexcept {
+      lower ^= out;
+
+      auto const carry = lower & 1;
+
+      lower >>= 1;
+      lower |= upper << 63;
+
+      upper >>= 1;
+      upper |= carry << 63;
+
+      mix<R>(in, length - 1);
+    }
+  };
+
+  // 64 bit counterpart of hash128 with the same interface, values are
+  // combined using 64 bit rotations
+  //
+  // keys are half the size and cheaper to compare and collapse, at the
+  // price of collisions becoming likely beyond a few 10^9 distinct keys
+  struct hash64 {
+    ::std::uint64_t value = 0;
+
+    friend bool operator==(hash64 const& l, hash64 const& r) noexcept {
+      return l.value == r.value;
+    }
+
+    friend bool operator!=(hash64 const& l, hash64 const& r) noexcept {
+      return l.value != r.value;
+    }
+
+    friend bool operator<(hash64 const& l, hash64 const& r) noexcept {
+      return l.value < r.value;
+    }
 
-      if (length < 64) {
-        lower ^= out << length;
-        upper ^= out >> (64 - length);
-      } else if (length < 128) { // shifting by 64 bits or more == UB
-        upper ^= out << (length - 64);
+    friend ::std::ostream& operator<<(::std::ostream& out, hash64 const& h) noexcept {
+      return out << h.value;
+    }
+
+    // the value is already a mix of hashes, a multiply spreads the
+    // minimizer values' unset high bits
+    ::std::uint64_t collapse() const noexcept {
+      auto const h = value * 0x9e3779b97f4a7c15ull;
+      return h ^ (h >> 32);
+    }
+
+    // xors 'value' rotated left by 'shift' % 64 bits into the hash,
+    // a rotation needs no branch so R is only there for hash128's sake
+    template<shift_range R = shift_range::any>
+    void mix(::std::uint64_t const in, ::std::size_t shift) noexcept {
+      shift %= 64;
+      value ^= (in << shift) | (in >> ((64 - shift) % 64));
+    }
+
+    void advance(::std::uint64_t const in) noexcept {
+      value = ((value << 1) | (value >> 63)) ^ in;
+    }
+
+    hash64() noexcept = default;
+
+    template<typename Iter>
+    hash64(Iter begin, Iter const end) noexcept {
+      while (begin != end) {
+        advance(*begin++);
       }
     }
+
+    template<shift_range R = shift_range::any>
+    void rotate(
+      ::std::uint64_t const in,
+      ::std::uint64_t const out,
+      ::std::size_t const length
+    ) noexcept {
+      advance(in);
+      mix(out, length);
+    }
+
+    template<shift_range R = shift_range::any>
+    void rotate_reversed(
+      ::std::uint64_t const in,
+      ::std::uint64_t const out,
+      ::std::size_t const length
+    ) noexcept {
+      value ^= out;
+      value = (value >> 1) | (value << 63);
+      mix(in, length - 1);
+    }
   };
 
+  // hash keying the nodes of the graph, picked at build time with
+  // -DMDBG_HASH_BITS=64 or 128
+#if defined(MDBG_HASH_BITS) && MDBG_HASH_BITS == 64
+  using node_hash = hash64;
+#else
+  using node_hash = hash128;
+#endif
+
 }
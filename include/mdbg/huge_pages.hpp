@@ -0,0 +1,86 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+
+namespace mdbg::huge_pages {
+
+  ::std::size_t constexpr page_size = 1 << 21;
+
+  // from then on allocations of at least a huge page through allocator
+  // below are mapped on their own and backed by huge pages, must be
+  // called before any of them is made
+  void enable() noexcept;
+
+  bool enabled() noexcept;
+
+  // bytes mapped so far from the hugetlbfs pool, and with transparent
+  // huge pages requested because the pool could not hold them
+  struct mapped {
+    ::std::size_t hugetlb;
+    ::std::size_t transparent;
+  };
+
+  mapped stats() noexcept;
+
+  // memory for the given bytes, rounded up to a multiple of page_size,
+  // taken from the hugetlbfs pool if it can hold it and otherwise mapped
+  // with transparent huge pages requested; kernels without either back
+  // it with normal pages
+  void* map(::std::size_t const bytes) noexcept;
+
+  void unmap(void* const ptr, ::std::size_t const bytes) noexcept;
+
+  // allocates large arrays through map when enabled and everything
+  // else through the fallback allocator
+  template<typename T, typename Fallback = ::std::allocator<T>>
+  class allocator : public Fallback {
+    using fallback_traits = ::std::allocator_traits<Fallback>;
+
+   public:
+    using value_type = T;
+
+    template<typename U>
+    struct rebind {
+      using other = allocator<
+        U, typename fallback_traits::template rebind_alloc<U>>;
+    };
+
+    allocator() noexcept = default;
+
+    template<typename U, typename F>
+    allocator(allocator<U, F> const& other) noexcept
+      : Fallback(static_cast<F const&>(other)) {}
+
+    T* allocate(::std::size_t const n) {
+      if (large(n)) {
+        return static_cast<T*>(map(n * sizeof(T)));
+      }
+      return fallback_traits::allocate(*this, n);
+    }
+
+    void deallocate(T* const ptr, ::std::size_t const n) noexcept {
+      if (large(n)) {
+        unmap(ptr, n * sizeof(T));
+      } else {
+        fallback_traits::deallocate(*this, ptr, n);
+      }
+    }
+
+    template<typename U, typename F>
+    bool operator==(allocator<U, F> const&) const noexcept {
+      return true;
+    }
+
+    template<typename U, typename F>
+    bool operator!=(allocator<U, F> const&) const noexcept {
+      return false;
+    }
+
+   private:
+    static bool large(::std::size_t const n) noexcept {
+      return enabled() && n * sizeof(T) >= page_size;
+    }
+  };
+
+}
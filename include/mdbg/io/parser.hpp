@@ -1,12 +1,36 @@
 #pragma once
 
+#include <cstddef>
 #include <string>
+#include <string_view>
 #include <functional>
 
 namespace mdbg::io {
 
   using fasta_constumer = ::std::function<void(::std::string&&, ::std::string&&)>;
 
-  void parse_fasta(char const* file, fasta_constumer& consumer) noexcept;
+  // keeps a read when a hash of its name falls into the given fraction,
+  // so that every run over the same file keeps the same reads
+  struct read_sampler {
+    double fraction = 1;
+
+    bool keep(::std::string_view const name) const noexcept;
+  };
+
+  struct parse_stats {
+    ::std::size_t skipped = 0;
+  };
+
+  // reads left out by 'sampler' are skipped as soon as their name is
+  // known, their bases are never copied
+  parse_stats parse_fasta(
+    char const* file,
+    fasta_constumer& consumer,
+    read_sampler const& sampler = {}
+  ) noexcept;
+
+  // fraction of the reads of 'file' holding about 'bases' bases, the size
+  // of compressed input is estimated from the ratio of its first part
+  double sampling_fraction(char const* file, double const bases) noexcept;
 
 }
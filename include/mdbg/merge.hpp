@@ -0,0 +1,9 @@
+#pragma once
+
+namespace mdbg {
+
+  // 'mdbg merge', joins the partitions written by runs with --partition
+  // into one graph, simplifies and writes it
+  int merge(int argc, char** argv) noexcept;
+
+}
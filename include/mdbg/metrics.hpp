@@ -0,0 +1,78 @@
+#pragma once
+
+#include <mdbg/opt.hpp>
+#include <mdbg/util.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace mdbg::metrics {
+
+  // resources used by the process up to a point in time
+  struct usage {
+    double wall_ms;
+    double cpu_ms;
+    ::std::size_t peak_rss;
+    ::std::size_t rss;
+    // resident memory backed by transparent or hugetlbfs huge pages
+    ::std::size_t huge_pages;
+
+    static usage now() noexcept;
+  };
+
+  struct phase {
+    ::std::string name;
+    usage begin;
+    usage end;
+    ::std::vector<::std::pair<::std::string, double>> values;
+  };
+
+  // time spent inside tasks of one kind, summed over all workers
+  class task_time {
+    ::std::atomic<::std::int64_t> ns = 0;
+
+   public:
+    template<typename F>
+    auto measure(F&& f) noexcept {
+      auto const begin = ::std::chrono::steady_clock::now();
+      auto const guard = ::mdbg::defer([this, begin]{
+        ns += ::std::chrono::duration_cast<::std::chrono::nanoseconds>(
+          ::std::chrono::steady_clock::now() - begin).count();
+      });
+      return f();
+    }
+
+    double ms() const noexcept {
+      return static_cast<double>(ns.load()) / 1e6;
+    }
+  };
+
+  // per phase report of run time and memory, written as JSON
+  //
+  // phases are recorded sequentially from the main thread, values
+  // are attached to the most recently started phase
+  class report {
+    usage const start = usage::now();
+    ::std::vector<phase> phases;
+
+   public:
+    void begin(::std::string name) noexcept;
+    void end() noexcept;
+
+    void set(::std::string key, double const value) noexcept;
+    
+    // sets key to value per second of the current phase's wall time,
+    // must be called after end()
+    void set_rate(::std::string key, double const value) noexcept;
+
+    void write(
+      ::std::string const& path,
+      command_line_options const& opts
+    ) const noexcept;
+  };
+
+}
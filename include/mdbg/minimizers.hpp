@@ -2,7 +2,10 @@
 
 #include <mdbg/opt.hpp>
 
+#include <cstdint>
 #include <memory>
+#include <memory_resource>
+#include <string_view>
 #include <vector>
 
 #include <tsl/robin_map.h>
@@ -10,19 +13,40 @@
 
 namespace mdbg {
 
+  // 'offset' and 'length' are the bases of the read the minimizer spans,
+  // more than l of them with homopolymer compression
   struct detected_minimizer {
     ::std::size_t read;
-    ::std::size_t offset;
+    ::std::uint32_t offset;
+    ::std::uint32_t length;
 
     ::std::uint64_t minimizer;
   };
 
-  using read_minimizers_t = ::std::vector<detected_minimizer>;
+  using read_minimizers_t = ::std::pmr::vector<detected_minimizer>;
 
+  // the minimizers are allocated from 'resource' in one piece
+  //
+  // l of 7, 14, 21 and 31 runs code compiled for that length, with
+  // opts.hpc the l-mers are taken from the read with every homopolymer
+  // run collapsed into a single base
   read_minimizers_t detect_minimizers(
-    ::std::string const& read,
+    ::std::string_view const read,
     ::std::size_t const read_id,
-    command_line_options const& opts
+    command_line_options const& opts,
+    ::std::pmr::memory_resource* const resource = ::std::pmr::get_default_resource()
   ) noexcept;
 
+  namespace detail {
+
+    // the code run for other values of l, for comparison
+    read_minimizers_t detect_minimizers_generic(
+      ::std::string_view const read,
+      ::std::size_t const read_id,
+      command_line_options const& opts,
+      ::std::pmr::memory_resource* const resource
+    ) noexcept;
+
+  }
+
 }
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include <tbb/task_arena.h>
+#include <tbb/task_group.h>
+
+namespace mdbg::numa {
+
+  // one task arena per NUMA node, its workers constrained to the node's
+  // cores so that memory they touch first is allocated on that node
+  //
+  // without NUMA support in TBB (tbbbind missing, or a single node) there
+  // is exactly one arena spanning the whole machine
+  class node_arenas {
+   public:
+    // max_threads of 0 uses all cores
+    explicit node_arenas(::std::size_t const max_threads) noexcept;
+
+    node_arenas(node_arenas const&) = delete;
+    node_arenas& operator=(node_arenas const&) = delete;
+
+    ::std::size_t size() const noexcept {
+      return nodes.size();
+    }
+
+    ::std::size_t concurrency(::std::size_t const node) const noexcept {
+      return static_cast<::std::size_t>(nodes[node]->arena.max_concurrency());
+    }
+
+    // runs f on a worker of the given node
+    template<typename F>
+    void run(::std::size_t const node, F&& f) noexcept {
+      auto& target = *nodes[node];
+      target.arena.execute([&target, &f] {
+        target.tasks.run(::std::forward<F>(f));
+      });
+    }
+
+    // waits for all tasks run so far and for the ones they run in turn,
+    // which must not run any further tasks
+    void wait() noexcept;
+
+   private:
+    struct node {
+      ::tbb::task_arena arena;
+      ::tbb::task_group tasks;
+
+      explicit node(::tbb::task_arena::constraints const& constraints) noexcept
+        : arena(constraints) {}
+    };
+
+    ::std::vector<::std::unique_ptr<node>> nodes;
+  };
+
+}
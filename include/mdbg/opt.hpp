@@ -3,6 +3,7 @@
 #include <optional>
 #include <ostream>
 #include <string>
+#include <vector>
 #include <cstdint>
 
 namespace mdbg {
@@ -15,16 +16,86 @@ namespace mdbg {
     ::std::size_t lower_threshold;
   };
 
+  // which l-mers are picked as minimizers
+  //
+  // universe     l-mers hashing below d * 2^64
+  // closed/open  syncmers, l-mers whose smallest s-mer lies at either end
+  //              or in the middle, thinned to the smallest of them in
+  //              every window of 1 / d - 1 l-mers
+  // bounded      universe minimizers, plus the smallest l-mer of every
+  //              max_gap bases that would otherwise have none, slightly
+  //              above d
+  enum class minimizer_scheme : ::std::uint8_t {
+    universe,
+    closed_syncmer,
+    open_syncmer,
+    bounded
+  };
+
+  char const* scheme_name(minimizer_scheme const scheme) noexcept;
+
   struct command_line_options {
     ::std::size_t threads;
     ::std::size_t k;
     ::std::size_t l;
     double d;
 
+    minimizer_scheme scheme;
+    // s-mer length of syncmers, and bases after which bounded picks a
+    // minimizer at the latest, 0 derives them from l and d
+    ::std::size_t syncmer_s = 0;
+    ::std::size_t max_gap = 0;
+
+    // pick minimizers from reads with homopolymer runs collapsed
+    bool hpc;
+
+    ::std::size_t min_abundance;
+
+    // skip reads whose minimizers all lie in order within another read,
+    // they then do not count towards min_abundance, which has to be 1
+    bool remove_contained;
+
+    // keep only enough reads for the given coverage of a genome of the
+    // given size in bases, 0 keeps all; 'sample' is the fraction of the
+    // reads kept, estimated from the input once it is opened
+    double target_coverage;
+    double genome_size;
+    double sample = 1;
+
+    // graph cleanup, lengths in bases, 0 disables the pass
+    ::std::size_t clip_tips;
+    ::std::size_t pop_bubbles;
+    bool break_loops;
+
+    // memory budget in bytes for partitioned construction, 0 builds
+    // the whole graph in memory
+    ::std::size_t max_memory;
+
+    // build only the nodes of one of 'partitions' partitions
+    ::std::size_t partition = 0;
+    ::std::size_t partitions = 1;
+
+    // spread work and graph shards over the NUMA nodes
+    bool numa;
+
+    // back the graph buckets, node index and read arenas with huge pages
+    bool huge_pages;
+
     bool analysis;
     bool dry_run;
     bool sequences;
-    // bool check_collisions;
+
+    // fraction of windows merged into a node whose minimizers are
+    // compared with the node's, 0 disables checking
+    double check_collisions;
+
+    // incremental assembly, save the graph for later runs and/or
+    // extend the one saved under the given prefix
+    bool save_graph;
+    ::std::string add_to;
+
+    // Chrome trace output path, empty disables tracing
+    ::std::string trace;
 
     ::std::optional<trio_binning_options> trio_binning = ::std::nullopt;
 
@@ -33,8 +104,27 @@ namespace mdbg {
 
     static command_line_options parse(int argc, char** argv) noexcept;
 
+    // derives the parameters left at 0 from the others and terminates on
+    // values or combinations that can not be assembled, 'parse' and the
+    // assembler call it so that options filled in by hand get the same
+    void resolve_defaults() noexcept;
+
     friend ::std::ostream& operator<<(
       ::std::ostream&, command_line_options const&) noexcept;
   };
 
+  // options of 'mdbg merge'
+  struct merge_options {
+    ::std::size_t threads;
+    bool dry_run;
+    bool sequences;
+
+    // reads the partitions were built from, needed to spell sequences
+    ::std::string input;
+    ::std::string output_prefix;
+    ::std::vector<::std::string> partitions;
+
+    static merge_options parse(int argc, char** argv) noexcept;
+  };
+
 }
@@ -12,6 +12,10 @@ namespace mdbg {
   template<char const* Format, typename Value>
   struct table_cell;
 
+  // cell showing a value owned elsewhere, read on every refresh
+  template<char const* Format, ::std::size_t (*Read)() noexcept>
+  struct live_cell;
+
   template<typename... TableCells>
   struct refreshing_table_display;
 
@@ -62,6 +66,38 @@ namespace mdbg {
     }
   };
 
+  template<char const* Format, ::std::size_t (*Read)() noexcept>
+  struct refreshing_table_display<live_cell<Format, Read>> {
+    ::std::atomic<bool> done = false;
+
+    bool is_done() const noexcept {
+      return done.load();
+    }
+
+    void print(FILE* out) const noexcept {
+      ::std::fprintf(out, Format, Read());
+      ::std::fflush(out);
+    }
+  };
+
+  template<char const* Format, ::std::size_t (*Read)() noexcept, typename... Rest>
+  struct refreshing_table_display<live_cell<Format, Read>, Rest...>
+    : refreshing_table_display<Rest...>
+  {
+    using parent_type = refreshing_table_display<Rest...>;
+
+    template<::std::size_t N>
+    void increment() noexcept {
+      static_assert(N != 0, "live cells can not be incremented");
+      parent_type::template increment<N - 1>();
+    }
+
+    void print(FILE* out) const noexcept {
+      ::std::fprintf(out, Format, Read());
+      parent_type::print(out);
+    }
+  };
+
   template<typename... Cells>
   struct table_printer {
     refreshing_table_display<Cells...> table = {};
@@ -1,12 +1,18 @@
 #pragma once
 
 #include <mdbg/nucleic_acid_iter.hpp>
+#include <mdbg/util.hpp>
 
 #include <biosoup_include.hpp>
 
+#include <zlib.h>
+
+#include <algorithm>
 #include <cstdint>
 #include <functional>
 #include <random>
+#include <string>
+#include <string_view>
 #include <vector>
 
 namespace mdbg::sim {
@@ -35,8 +41,56 @@ namespace mdbg::sim {
       /*.min_coverage  =*/  30ul,
     };
 
+    auto inline constexpr OxfordNanopore = config{
+      /*.read_length =*/    30'000ul,
+      /*.read_deviation =*/ 15'000ul, 
+      /*.min_coverage  =*/  30ul,
+    };
+
   }
 
+  // per base error probabilities
+  struct error_model {
+    double substitution;
+    double insertion;
+    double deletion;
+    // probability of a homopolymer run (3 or more bases) being read one
+    // base longer or shorter, on top of the errors above
+    double homopolymer;
+  };
+
+  namespace error_models {
+
+    auto inline constexpr ErrorFree = error_model{0, 0, 0, 0};
+
+    // ~0.1% errors, mostly homopolymer length errors
+    auto inline constexpr PacBioHiFi = error_model{
+      /*.substitution =*/ 0.0002,
+      /*.insertion =*/    0.0002,
+      /*.deletion =*/     0.0002,
+      /*.homopolymer =*/  0.01,
+    };
+
+    // ~5% errors, deletions and homopolymers dominate
+    auto inline constexpr OxfordNanopore = error_model{
+      /*.substitution =*/ 0.015,
+      /*.insertion =*/    0.01,
+      /*.deletion =*/     0.02,
+      /*.homopolymer =*/  0.1,
+    };
+
+  }
+
+  // copies of one random segment placed around the genome
+  struct repeat_config {
+    ::std::size_t count;
+    ::std::size_t length;
+    // fraction of bases substituted in each copy
+    double divergence;
+    // place every other copy reverse complemented
+    bool inverted;
+  };
+
   struct read {
     // offset form the start of the complete assembly
     ::std::size_t offset;
@@ -48,7 +102,8 @@ namespace mdbg::sim {
   inline ::std::vector<read> simulate(
     ::biosoup::NucleicAcid const& sequence,
     ::std::size_t const cutoff,
-    config const& config
+    config const& config,
+    ::std::uint64_t const seed
   ) noexcept {
     // size of the given sample to generate reads from
     ::std::size_t const size = cutoff;
@@ -65,7 +120,7 @@ namespace mdbg::sim {
       )
     );
 
-    ::std::mt19937 mt{::std::random_device{}()};
+    ::std::mt19937_64 mt{seed};
 
     ::std::uniform_int_distribution<::std::size_t>
       read_begin_gen(0, size - 1);
@@ -112,4 +167,196 @@ namespace mdbg::sim {
     return simulated_reads;
   }
 
+  namespace detail {
+
+    inline char random_base(::std::mt19937_64& mt) noexcept {
+      return "ACGT"[mt() & 3];
+    }
+
+    inline char random_other_base(char const base, ::std::mt19937_64& mt) noexcept {
+      char rv;
+      do {
+        rv = random_base(mt);
+      } while (rv == base);
+      return rv;
+    }
+
+    inline void reverse_complement(::std::string& sequence) noexcept {
+      ::std::reverse(sequence.begin(), sequence.end());
+      for (auto& base : sequence) {
+        switch (base) {
+          case 'A': base = 'T'; break;
+          case 'C': base = 'G'; break;
+          case 'G': base = 'C'; break;
+          case 'T': base = 'A'; break;
+          default: break;
+        }
+      }
+    }
+
+  }
+
+  inline ::std::string random_genome(
+    ::std::size_t const length,
+    ::std::uint64_t const seed
+  ) noexcept {
+    ::std::mt19937_64 mt{seed};
+    ::std::string rv(length, 'A');
+
+    // 32 bases per random number
+    for (::std::size_t i = 0; i < length; i += 32) {
+      auto bits = mt();
+      for (auto j = i; j < ::std::min(i + 32, length); ++j, bits >>= 2) {
+        rv[j] = "ACGT"[bits & 3];
+      }
+    }
+
+    return rv;
+  }
+
+  inline void inject_repeats(
+    ::std::string& genome,
+    repeat_config const& config,
+    ::std::uint64_t const seed
+  ) noexcept {
+    if (config.count == 0 || config.length == 0 || config.length > genome.size()) {
+      return;
+    }
+
+    ::std::mt19937_64 mt{seed};
+    ::std::uniform_int_distribution<::std::size_t> position(
+      0, genome.size() - config.length);
+    ::std::bernoulli_distribution substitute(config.divergence);
+
+    auto const repeat = genome.substr(position(mt), config.length);
+
+    for (::std::size_t i = 0; i < config.count; ++i) {
+      auto copy = repeat;
+      if (config.inverted && i % 2 == 1) {
+        detail::reverse_complement(copy);
+      }
+
+      for (auto& base : copy) {
+        if (substitute(mt)) {
+          base = detail::random_other_base(base, mt);
+        }
+      }
+
+      genome.replace(position(mt), config.length, copy);
+    }
+  }
+
+  // copies 'read' with errors drawn from 'model' appended to 'out'
+  inline void apply_errors(
+    ::std::string_view const read,
+    error_model const& model,
+    ::std::mt19937_64& mt,
+    ::std::string& out
+  ) noexcept {
+    ::std::uniform_real_distribution<double> uniform(0, 1);
+
+    auto const substitution = model.substitution;
+    auto const insertion = substitution + model.insertion;
+    auto const deletion = insertion + model.deletion;
+
+    for (::std::size_t i = 0; i < read.size();) {
+      // whole homopolymer runs are handled at once
+      auto run = i + 1;
+      while (run < read.size() && read[run] == read[i]) {
+        ++run;
+      }
+
+      auto length = run - i;
+      if (length >= 3 && uniform(mt) < model.homopolymer) {
+        length = mt() & 1 ? length + 1 : length - 1;
+      }
+
+      for (::std::size_t j = 0; j < length; ++j) {
+        auto const u = uniform(mt);
+        if (u < substitution) {
+          out.push_back(detail::random_other_base(read[i], mt));
+        } else if (u < insertion) {
+          out.push_back(detail::random_base(mt));
+          out.push_back(read[i]);
+        } else if (u >= deletion) {
+          out.push_back(read[i]);
+        }
+      }
+
+      i = run;
+    }
+  }
+
+  // samples reads from both strands of 'genome' until it is covered
+  // 'config.min_coverage' times, 'consumer' gets each read's name and bases
+  template<typename F>
+  void generate_reads(
+    ::std::string const& genome,
+    config const& config,
+    error_model const& model,
+    ::std::uint64_t const seed,
+    F&& consumer
+  ) noexcept {
+    ::std::mt19937_64 mt{seed};
+
+    ::std::normal_distribution<double> read_length_gen(
+      static_cast<double>(config.read_length), 
+      static_cast<double>(config.read_deviation));
+
+    auto const min_len = ::std::min<::std::size_t>(
+      genome.size(), ::std::max<::std::size_t>(config.read_deviation, 1));
+
+    ::std::size_t const target = genome.size() * config.min_coverage;
+    ::std::string read;
+
+    for (::std::size_t sampled = 0, i = 0; sampled < target; ++i) {
+      auto const length = ::std::clamp<::std::size_t>(
+        static_cast<::std::size_t>(::std::max(read_length_gen(mt), 0.0)),
+        min_len, genome.size());
+
+      ::std::uniform_int_distribution<::std::size_t> begin(0, genome.size() - length);
+      auto const exact = ::std::string_view{genome}.substr(begin(mt), length);
+
+      read.clear();
+      apply_errors(exact, model, mt, read);
+      if (mt() & 1) {
+        detail::reverse_complement(read);
+      }
+
+      consumer(i, read);
+      sampled += length;
+    }
+  }
+
+  // writes generated reads as FASTA, gzip compressed if 'path' ends in .gz
+  inline ::std::size_t write_reads(
+    ::std::string const& path,
+    ::std::string const& genome,
+    config const& config,
+    error_model const& model,
+    ::std::uint64_t const seed
+  ) noexcept {
+    auto const compressed = path.size() > 3 && path.compare(path.size() - 3, 3, ".gz") == 0;
+
+    // 'T' makes zlib write through uncompressed
+    auto* out = ::gzopen(path.c_str(), compressed ? "wb1" : "wbT");
+    if (out == nullptr) {
+      ::mdbg::terminate("unable to open/create ", path);
+    }
+
+    ::std::size_t reads = 0;
+    generate_reads(genome, config, model, seed, [out, &reads](auto const i, auto const& read) {
+      ::gzprintf(out, ">read%lu\n", i);
+      ::gzwrite(out, read.data(), static_cast<unsigned>(read.size()));
+      ::gzputc(out, '\n');
+      ++reads;
+    });
+
+    if (::gzclose(out) != Z_OK) {
+      ::mdbg::terminate("unable to write reads to ", path);
+    }
+
+    return reads;
+  }
+
 }
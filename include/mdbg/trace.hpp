@@ -0,0 +1,59 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+// task timeline in Chrome trace format (chrome://tracing, ui.perfetto.dev)
+//
+// every thread records into its own fixed size ring buffer, so recording
+// never takes a lock; once a buffer is full the oldest events are dropped
+
+namespace mdbg::trace {
+
+  namespace detail {
+    inline ::std::atomic<bool> enabled = false;
+  }
+
+  // starts recording with room for 'capacity' events per thread
+  void enable(::std::size_t const capacity = 1 << 16) noexcept;
+
+  inline bool is_enabled() noexcept {
+    return detail::enabled.load(::std::memory_order_relaxed);
+  }
+
+  // nanoseconds since enable()
+  ::std::int64_t now() noexcept;
+
+  // 'name' has to outlive the trace, a string literal in practice
+  void record(
+    char const* name,
+    ::std::int64_t const begin,
+    ::std::int64_t const end
+  ) noexcept;
+
+  // writes all recorded events, must not race with recording threads
+  void write(::std::string const& path) noexcept;
+
+  // records its lifetime as a single event
+  class scope {
+    char const* name;
+    ::std::int64_t begin;
+
+   public:
+    explicit scope(char const* name) noexcept
+      : name(name)
+      , begin(is_enabled() ? now() : 0)
+    {}
+
+    scope(scope const&) = delete;
+    scope& operator=(scope const&) = delete;
+
+    ~scope() {
+      if (is_enabled()) {
+        record(name, begin, now());
+      }
+    }
+  };
+
+}
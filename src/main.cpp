@@ -2,30 +2,75 @@
 #include <cstdint>
 #include <cstdio>
 #include <cstdlib>
+#include <deque>
+#include <filesystem>
 #include <fstream>
 #include <iostream>
-#include <mutex>
+#include <optional>
 #include <string>
+#include <string_view>
 #include <thread>
+#include <type_traits>
 
 #include <mdbg/opt.hpp>
+#include <mdbg/merge.hpp>
+#include <mdbg/assembler.hpp>
+#include <mdbg/containment.hpp>
+#include <mdbg/huge_pages.hpp>
 #include <mdbg/io/parser.hpp>
 #include <mdbg/util.hpp>
+#include <mdbg/metrics.hpp>
+#include <mdbg/counters.hpp>
+#include <mdbg/trace.hpp>
 #include <mdbg/minimizers.hpp>
 #include <mdbg/graph/simplification.hpp>
+#include <mdbg/graph/cleanup.hpp>
 #include <mdbg/graph/construction.hpp>
+#include <mdbg/graph/partition.hpp>
+#include <mdbg/graph/serialization.hpp>
+#include <mdbg/graph/incremental.hpp>
 #include <mdbg/trio_binning/trio_binning.hpp>
 #include <mdbg/refreshing_table_display.hpp>
 
-#include <tbb/parallel_for.h>
-#include <tbb/blocked_range.h>
 #include <tbb/global_control.h>
-#include <tbb/task_group.h>
 
 int main(int argc, char** argv) {
+  if (argc > 1 && ::std::string_view{argv[1]} == "merge") {
+    return ::mdbg::merge(argc - 1, argv + 1);
+  }
+
   auto opts = ::mdbg::command_line_options::parse(argc, argv);
   auto timer = ::mdbg::timer{};
 
+  ::mdbg::metrics::report report;
+  auto const partition_path = 
+    ::mdbg::graph::partition_path(opts.output_prefix, opts);
+
+  // runs of different partitions usually share an output prefix
+  auto const metrics_path = 
+    (opts.partitions > 1 ? partition_path : opts.output_prefix) + ".metrics.json";
+  auto const graph_path = opts.output_prefix + ".graph";
+  auto const unitigs_path = opts.output_prefix + ".unitigs";
+
+  if (!opts.trace.empty()) {
+    ::mdbg::trace::enable();
+  }
+
+  auto const write_trace = [&opts] {
+    if (!opts.trace.empty()) {
+      ::mdbg::trace::write(opts.trace);
+    }
+  };
+
+  // before anything is allocated through it
+  if (opts.huge_pages) {
+    ::mdbg::huge_pages::enable();
+  }
+
+  if (opts.check_collisions > 0) {
+    ::mdbg::graph::check_collisions(opts);
+  }
+
   ::tbb::global_control max_parallelism{
     ::tbb::global_control::max_allowed_parallelism, 
     opts.threads ? opts.threads : ::std::thread::hardware_concurrency()};
@@ -38,67 +83,177 @@ int main(int argc, char** argv) {
     ::std::fprintf(stderr, "### ANALYSIS ###\n");
   }
   
-  using processed_pair_t = ::std::pair<::std::string, ::mdbg::read_minimizers_t>;
+  ::mdbg::assembler assembler{opts};
+
+  // minimizers of the nodes of a saved graph, reads added to it are
+  // numbered after the ones it was built from
+  ::std::deque<::mdbg::read_minimizers_t> saved_windows;
+  ::std::size_t saved_unitigs = 0;
+  ::std::size_t saved_reads = 0;
+
+  auto& graph = assembler.graph();
 
-  ::std::vector<::std::unique_ptr<processed_pair_t>> processed;
-  ::mdbg::graph::de_bruijn_graph_t graph;
+  if (!opts.add_to.empty() && !opts.analysis) {
+    report.begin("load_graph");
+    ::std::vector<::mdbg::graph::detail::compact_minimizer> boundary;
+    auto const header = ::mdbg::graph::load_graph(
+      opts.add_to + ".graph", graph, saved_windows, boundary);
 
-  ::tbb::task_group tg;
-  ::std::mutex tg_lock;
+    if (header.k != opts.k || header.l != opts.l || header.d != opts.d
+        || header.scheme != static_cast<::std::uint64_t>(opts.scheme)
+        || header.syncmer_s != opts.syncmer_s || header.max_gap != opts.max_gap
+        || header.hpc != opts.hpc
+        || header.partitions != 1) {
+      ::mdbg::terminate(opts.add_to, 
+        ".graph was built with different -k, -l, -d, minimizer scheme or --hpc");
+    }
+
+    saved_reads = header.reads;
+    auto unitigs = ::mdbg::graph::load_unitigs(opts.add_to + ".unitigs", opts);
+    saved_unitigs = unitigs.size();
+    assembler.resume(saved_reads, ::std::move(unitigs));
+    report.end();
+
+    ::std::printf(
+      "loaded saved graph with %lu node(s) and %lu unitig(s) from %lu sequences in %ld ms\n",
+      graph.size(), saved_unitigs, saved_reads, timer.reset_ms());
+    ::std::fflush(stdout);
+  }
+
+  if (opts.numa) {
+    ::std::printf("running on %lu NUMA node(s)\n", assembler.numa_nodes());
+    ::std::fflush(stdout);
+  }
+
+  if (opts.target_coverage > 0) {
+    opts.sample = ::mdbg::io::sampling_fraction(
+      opts.input.c_str(), opts.target_coverage * opts.genome_size);
+
+    ::std::printf(
+      "keeping %.1f%% of the sequences for %gx coverage of %g bases\n",
+      opts.sample * 100, opts.target_coverage, opts.genome_size);
+    ::std::fflush(stdout);
+  }
 
   static char const fmt_0[] = "\rsequences -- loaded: %8ld,";
   static char const fmt_1[] = " processed: %8ld,";
   static char const fmt_2[] = " assembled: %8ld";
+  static char const fmt_3[] = ", new nodes: %10ld";
+  static char const fmt_4[] = ", lock wait: %6ld ms";
+
+  using counter = ::mdbg::counters::counter;
 
-  ::mdbg::table_printer<
-    ::mdbg::table_cell<fmt_0, ::std::size_t>,
-    ::mdbg::table_cell<fmt_1, ::std::size_t>,
-    ::mdbg::table_cell<fmt_2, ::std::size_t>
+  // with counters compiled in, contention is shown live as well
+  ::std::conditional_t<
+    ::mdbg::counters::enabled,
+    ::mdbg::table_printer<
+      ::mdbg::table_cell<fmt_0, ::std::size_t>,
+      ::mdbg::table_cell<fmt_1, ::std::size_t>,
+      ::mdbg::table_cell<fmt_2, ::std::size_t>,
+      ::mdbg::live_cell<fmt_3, ::mdbg::counters::read<counter::insert_miss>>,
+      ::mdbg::live_cell<fmt_4, ::mdbg::counters::read_ms<counter::accessor_wait_ns>>>,
+    ::mdbg::table_printer<
+      ::mdbg::table_cell<fmt_0, ::std::size_t>,
+      ::mdbg::table_cell<fmt_1, ::std::size_t>,
+      ::mdbg::table_cell<fmt_2, ::std::size_t>>
   > printer{50, stdout};
 
+  assembler.on_progress({
+    [&printer] { printer.table.increment<1>(); },
+    [&printer] { printer.table.increment<2>(); }});
+
   ::mdbg::io::fasta_constumer consumer = 
-    [&printer, &processed, &graph, &tg, &tg_lock, &opts](auto&&, auto&& seq) {
+    [&printer, &assembler](auto&&, auto&& seq) {
       printer.table.increment<0>();
-
-      processed.emplace_back(
-        ::std::make_unique<processed_pair_t>(
-          processed_pair_t{::std::forward<::std::string>(seq), {}}));
-      auto const index = processed.size() - 1;
-
-      ::std::scoped_lock<decltype(tg_lock)> scoped_detection{tg_lock};
-      tg.run([
-        &printer, &tg, &tg_lock, ptr = processed.back().get(), 
-        &graph, &opts, index
-      ]{
-        ptr->second = ::mdbg::detect_minimizers(ptr->first, index, opts);
-        printer.table.increment<1>();
-
-        if (!opts.analysis) {
-          ::std::scoped_lock<decltype(tg_lock)> scoped_construction{tg_lock};
-          tg.run([&printer, &graph, ptr, &opts]{
-            ::mdbg::graph::construct(graph, ptr->second, opts);
-              printer.table.increment<2>();
-          });
-        }
-      });
+      assembler.push(seq);
     };
 
-  ::mdbg::io::parse_fasta(opts.input.c_str(), consumer);
-  tg.wait();
+  // parsing, detection and construction are pipelined,
+  // the time spent in each is reported separately
+  report.begin("load");
+  auto const parse_timer = ::mdbg::timer{};
+
+  auto const parsed = ::mdbg::io::parse_fasta(opts.input.c_str(), consumer, {opts.sample});
+  report.set("parse_ms", static_cast<double>(parse_timer.get_ms()));
+  assembler.wait();
+
+  auto const loaded = assembler.stats();
+  auto const reads = assembler.reads();
+
+  report.end();
+  report.set("detection_task_ms", loaded.detection_task_ms);
+  report.set("construction_task_ms", loaded.construction_task_ms);
+  report.set("read_batches", static_cast<double>(loaded.read_batches));
+  report.set("bytes_in", static_cast<double>(::std::filesystem::file_size(opts.input)));
+  report.set("reads", static_cast<double>(reads));
+  report.set("skipped_reads", static_cast<double>(parsed.skipped));
+  report.set("arena_bytes", static_cast<double>(loaded.arena_bytes));
+  if (opts.huge_pages) {
+    auto const mapped = ::mdbg::huge_pages::stats();
+    report.set("hugetlb_mapped_bytes", static_cast<double>(mapped.hugetlb));
+    report.set("transparent_mapped_bytes", static_cast<double>(mapped.transparent));
+  }
+  report.set("bases", static_cast<double>(loaded.bases));
+  report.set_rate("reads_per_s", static_cast<double>(reads));
+  report.set_rate("bases_per_s", static_cast<double>(loaded.bases));
+
+  ::mdbg::containment_stats redundant;
+
+  if (opts.remove_contained && !opts.analysis) {
+    report.begin("containment");
+    auto const removed = assembler.find_redundant(redundant);
+    report.end();
+    report.set("duplicate_reads", static_cast<double>(redundant.duplicates));
+    report.set("contained_reads", static_cast<double>(redundant.contained));
+
+    report.begin("construct");
+    assembler.construct(removed);
+    report.end();
+  }
+
+  report.begin("flush");
+  assembler.flush();
+  report.end();
+
+  // windows absorbed by the thread local batches without touching the graph
+  auto const flushed = assembler.stats();
+  report.set("batch_windows", static_cast<double>(flushed.batch_windows));
+  report.set("batch_hits", static_cast<double>(flushed.batch_hits));
+  report.set("batch_hit_rate", flushed.batch_windows 
+    ? static_cast<double>(flushed.batch_hits) / static_cast<double>(flushed.batch_windows)
+    : 0.0);
+
+  auto const collisions = ::mdbg::graph::collisions();
+  if (opts.check_collisions > 0) {
+    report.set("collision_checks", static_cast<double>(collisions.checked));
+    report.set("collisions", static_cast<double>(collisions.collisions));
+  }
 
   printer.table.done = true;
 
   ::std::printf(
     "\rloaded, processed and assembled a graph "
     "from %lu sequences in %ld ms            \n", 
-    processed.size(), timer.reset_ms());
+    reads, timer.reset_ms());
+
+  if (opts.remove_contained && !opts.analysis) {
+    ::std::printf(
+      "left out %lu duplicate and %lu contained sequence(s)\n",
+      redundant.duplicates, redundant.contained);
+  }
+
+  if (opts.check_collisions > 0) {
+    ::std::printf(
+      "found %lu hash collision(s) in %lu window(s) checked against their nodes\n",
+      collisions.collisions, collisions.checked);
+  }
 
   opts.output_prefix += ".gfa";
 
-  ::std::vector<::std::size_t> stats(processed.size());
+  ::std::vector<::std::size_t> stats(reads);
 
   for (::std::size_t i = 0; i < stats.size(); ++i) {
-    stats[i] = processed[i]->second.size();
+    stats[i] = assembler.read_minimizers(i).size();
   }
 
   auto const time = timer.reset_ms();
@@ -125,43 +280,234 @@ int main(int argc, char** argv) {
     get_percentile(0.999),
     get_percentile(0.9999),
     stats.front());
+
+  // gaps in bases between consecutive minimizers of a read, counted per
+  // length as they are bounded by the read length
+  ::std::vector<::std::size_t> gaps;
+  ::std::size_t gap_count = 0;
+  for (::std::size_t read = 0; read < reads; ++read) {
+    auto const& read_minimizers = assembler.read_minimizers(read);
+    for (::std::size_t i = 1; i < read_minimizers.size(); ++i) {
+      auto const gap = read_minimizers[i].offset - read_minimizers[i - 1].offset;
+      if (gap >= gaps.size()) {
+        gaps.resize(gap + 1);
+      }
+      ++gaps[gap];
+      ++gap_count;
+    }
+  }
+
+  auto const get_gap_percentile = [&gaps, gap_count](double const percentile) {
+    auto const rank = static_cast<::std::size_t>(static_cast<double>(gap_count) * percentile);
+    ::std::size_t seen = 0;
+    for (::std::size_t gap = 0; gap < gaps.size(); ++gap) {
+      seen += gaps[gap];
+      if (seen > rank) {
+        return gap;
+      }
+    }
+    return gaps.empty() ? ::std::size_t{0} : gaps.size() - 1;
+  };
+
+  ::std::printf(
+    "gaps between minimizers in bases (%s scheme):\n"
+    "  median:             %lu\n"
+    "  90th    percentile: %lu\n"
+    "  99th    percentile: %lu\n"
+    "  99.9th  percentile: %lu\n"
+    "  99.99th percentile: %lu\n"
+    "  max:                %lu\n",
+    ::mdbg::scheme_name(opts.scheme),
+    get_gap_percentile(0.5),
+    get_gap_percentile(0.9),
+    get_gap_percentile(0.99),
+    get_gap_percentile(0.999),
+    get_gap_percentile(0.9999),
+    gaps.empty() ? ::std::size_t{0} : gaps.size() - 1);
   ::std::fflush(stdout);
   
   if (opts.analysis) {
+    if (!opts.dry_run) {
+      report.write(metrics_path, opts);
+    }
+    ::mdbg::counters::print(stdout);
+    write_trace();
     ::std::exit(EXIT_SUCCESS);
   }
 
-  ::std::printf(
-    "assembled de Bruijn graph (k = %lu) with %lu node(s)\n",
-    opts.k, graph.size());
-  ::std::fflush(stdout);
+  auto const graph_metrics = [&report, &graph] {
+    report.set("nodes", static_cast<double>(graph.size()));
+    report.set("edges", static_cast<double>(::mdbg::graph::count_edges(graph)));
+    report.set("load_factor", 
+      static_cast<double>(graph.size()) / static_cast<double>(graph.bucket_count()));
+  };
 
-  auto const simplified = ::mdbg::graph::simplify(graph);
+  auto const simplified_metrics = [&report](auto const& simplified) {
+    report.set("unitigs", static_cast<double>(simplified.size()));
+    report.set("unitig_load_factor", 
+      static_cast<double>(simplified.size()) 
+        / static_cast<double>(simplified.bucket_count()));
+  };
 
-  ::std::printf(
-    "simplified to %lu node(s) in %ld ms\n",
-    simplified.size(), timer.reset_ms());
-  ::std::fflush(stdout);
+  ::mdbg::assembly_hooks hooks;
+
+  hooks.begin = [&report](char const* step) { report.begin(step); };
+  hooks.end = [&report] { report.end(); };
+
+  hooks.partitioned = [&](::mdbg::graph::partition_stats const& partitioned) {
+    report.set("partitions", static_cast<double>(partitioned.partitions));
+    report.set("nodes", static_cast<double>(partitioned.nodes));
+    report.set("removed_nodes", static_cast<double>(partitioned.removed));
+    report.set("fragments", static_cast<double>(partitioned.fragments));
+    report.set("oversized_partitions", static_cast<double>(partitioned.oversized));
+
+    ::std::printf(
+      "assembled de Bruijn graph (k = %lu) with %lu node(s) in %lu partition(s), "
+      "removed %lu node(s) with abundance below %lu, "
+      "stitched %lu fragment(s) in %ld ms\n",
+      opts.k, partitioned.nodes, partitioned.partitions,
+      partitioned.removed, opts.min_abundance,
+      partitioned.fragments, timer.reset_ms());
+
+    if (partitioned.oversized) {
+      ::std::printf(
+        "WARNING: %lu partition(s) of a single bucket did not fit into --max-memory, "
+        "the reads alone may already take up most of it\n",
+        partitioned.oversized);
+    }
+    ::std::fflush(stdout);
+  };
+
+  hooks.constructed = [&](::mdbg::graph::de_bruijn_graph_t const& graph) {
+    graph_metrics();
+
+    ::std::printf(
+      "assembled de Bruijn graph (k = %lu) with %lu node(s)\n",
+      opts.k, graph.size());
+
+    // a 64 bit build is only meant for graphs small enough to rule
+    // collisions out
+    auto const expected = ::mdbg::graph::expected_collisions(graph.size());
+    report.set("expected_collisions", expected);
+    if (sizeof(::mdbg::node_hash) * 8 < 128 && expected >= 0.01) {
+      ::std::printf(
+        "WARNING: %g hash collision(s) are expected among that many nodes, "
+        "consider building with -DMDBG_HASH_BITS=128 or --check-collisions\n",
+        expected);
+    }
+    ::std::fflush(stdout);
+
+    // saved before filtering, later reads may lift nodes above it
+    if (opts.save_graph && !opts.dry_run) {
+      report.begin("save_graph");
+      ::mdbg::graph::save_graph(graph_path, graph, saved_reads + reads, opts);
+      report.end();
+
+      ::std::printf(
+        "saved graph to '%s' in %ld ms\n", graph_path.c_str(), timer.reset_ms());
+      ::std::fflush(stdout);
+    }
+  };
+
+  hooks.filtered = [&](::std::size_t const removed) {
+    graph_metrics();
+
+    ::std::printf(
+      "removed %lu node(s) with abundance below %lu in %ld ms\n",
+      removed, opts.min_abundance, timer.reset_ms());
+    ::std::fflush(stdout);
+  };
+
+  hooks.recomputed = [&](::mdbg::graph::incremental_stats const& incremental) {
+    report.set("touched_nodes", static_cast<double>(incremental.touched));
+    report.set("dirty_nodes", static_cast<double>(incremental.dirty));
+    report.set("kept_unitigs", static_cast<double>(incremental.kept));
+    report.set("recomputed_nodes", static_cast<double>(incremental.recomputed));
+
+    ::std::printf(
+      "kept %lu of %lu unitig(s), %lu node(s) near %lu touched node(s) to recompute\n",
+      incremental.kept, saved_unitigs, incremental.recomputed, incremental.touched);
+  };
+
+  hooks.simplified = [&](::mdbg::graph::simplified_graph_t const& simplified) {
+    if (opts.save_graph && !opts.dry_run) {
+      ::mdbg::graph::save_unitigs(unitigs_path, simplified, opts);
+    }
+
+    simplified_metrics(simplified);
+
+    ::std::printf(
+      "simplified to %lu node(s) in %ld ms\n",
+      simplified.size(), timer.reset_ms());
+    ::std::fflush(stdout);
+  };
+
+  hooks.cleaned = [&](
+    ::mdbg::graph::cleanup_stats const& cleaned,
+    ::mdbg::graph::simplified_graph_t const& simplified
+  ) {
+    report.set("tips", static_cast<double>(cleaned.tips));
+    report.set("bubbles", static_cast<double>(cleaned.bubbles));
+    report.set("loops", static_cast<double>(cleaned.loops));
+    graph_metrics();
+    simplified_metrics(simplified);
+
+    ::std::printf(
+      "clipped %lu tip(s), popped %lu bubble(s), broke %lu loop link(s), "
+      "%lu node(s) left in %ld ms\n",
+      cleaned.tips, cleaned.bubbles, cleaned.loops,
+      simplified.size(), timer.reset_ms());
+    ::std::fflush(stdout);
+  };
+
+  auto const assembly = assembler.finish(hooks);
+
+  if (opts.partitions > 1) {
+    if (!opts.dry_run) {
+      report.begin("write");
+      ::mdbg::graph::save_graph(partition_path, assembly.graph(), reads, opts);
+      report.end();
+      report.set("bytes_out", 
+        static_cast<double>(::std::filesystem::file_size(partition_path)));
+
+      ::std::printf(
+        "wrote partition %lu of %lu to '%s' in %ld ms\n",
+        opts.partition, opts.partitions, partition_path.c_str(), timer.reset_ms());
+      ::std::fflush(stdout);
+
+      report.write(metrics_path, opts);
+    }
+
+    ::mdbg::counters::print(stdout);
+    write_trace();
+    ::std::quick_exit(EXIT_SUCCESS);
+  }
 
   if (!opts.dry_run) {
+    report.begin("write");
     ::std::ofstream out{opts.output_prefix};
     if (!out.is_open()) {
       ::mdbg::terminate("unable to open/create given output file ", opts.output_prefix);
     }
 
-    ::mdbg::graph::write_gfa(
-      out, 
-      simplified, 
-      [&processed](auto&& i) -> std::string const& { return processed[i]->first; },
-      opts);
+    assembly.write_gfa(out);
+    out.flush();
+
+    report.end();
+    report.set("bytes_out", static_cast<double>(out.tellp()));
     
     ::std::printf(
       "wrote de Bruijn graph to '%s' in %ld ms\n",
       opts.output_prefix.c_str(),
       timer.reset_ms());
     ::std::fflush(stdout);
+
+    report.write(metrics_path, opts);
   }
 
+  ::mdbg::counters::print(stdout);
+  write_trace();
+
   // no side effects other than memory release at this point
   ::std::quick_exit(EXIT_SUCCESS);
 }
@@ -0,0 +1,43 @@
+#include <mdbg/arena.hpp>
+
+#include <memory>
+
+namespace mdbg {
+
+  ::std::size_t arena::reserved() const noexcept {
+    ::std::size_t rv = 0;
+    for (auto const& thread : local) {
+      rv += thread.reserved;
+    }
+    return rv;
+  }
+
+  void* arena::do_allocate(::std::size_t bytes, ::std::size_t alignment) {
+    auto& thread = local.local();
+
+    void* ptr = thread.current;
+    if (::std::align(alignment, bytes, ptr, thread.left)) {
+      thread.current = static_cast<::std::byte*>(ptr) + bytes;
+      thread.left -= bytes;
+      return ptr;
+    }
+
+    // large objects get a block of their own, the current chunk
+    // is kept for the small ones that follow
+    auto const large = bytes + alignment > chunk_size / 4;
+    auto space = large ? bytes + alignment : chunk_size;
+
+    ptr = block_allocator{}.allocate(space);
+    thread.blocks.emplace_back(static_cast<::std::byte*>(ptr), space);
+    thread.reserved += space;
+    ::std::align(alignment, bytes, ptr, space);
+
+    if (!large) {
+      thread.current = static_cast<::std::byte*>(ptr) + bytes;
+      thread.left = space - bytes;
+    }
+
+    return ptr;
+  }
+
+}
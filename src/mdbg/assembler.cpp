@@ -0,0 +1,450 @@
+#include <mdbg/assembler.hpp>
+#include <mdbg/arena.hpp>
+#include <mdbg/batching.hpp>
+#include <mdbg/numa.hpp>
+#include <mdbg/trace.hpp>
+#include <mdbg/metrics.hpp>
+#include <mdbg/util.hpp>
+
+#include <tbb/enumerable_thread_specific.h>
+#include <tbb/parallel_for.h>
+#include <tbb/parallel_for_each.h>
+#include <tbb/blocked_range.h>
+#include <tbb/task_group.h>
+
+#include <deque>
+#include <memory_resource>
+#include <string>
+#include <utility>
+
+namespace mdbg {
+
+  using processed_pair_t = ::std::pair<::std::pmr::string, read_minimizers_t>;
+
+  // reads are detected and constructed a batch per task, in the order
+  // they were pushed
+  using read_batch_t = ::std::vector<processed_pair_t*>;
+
+  struct assembler::state {
+    command_line_options opts;
+    assembly_progress progress;
+
+    // reads and their minimizers are kept until the end, they are
+    // allocated from an arena and the records themselves in blocks by
+    // the deque
+    ::mdbg::arena reads_arena;
+    ::std::deque<processed_pair_t> processed;
+    ::std::size_t first_read = 0;
+
+    graph::de_bruijn_graph_t graph;
+
+    // unitigs of a resumed graph, nodes touched by the pushed reads are
+    // recorded per batch to walk again only the unitigs around them
+    ::std::optional<graph::saved_unitigs_t> saved_unitigs;
+    ::tbb::enumerable_thread_specific<graph::construction_batch> batches;
+
+    // with a memory budget windows are streamed to disk instead
+    ::std::optional<graph::partitioned_windows> windows;
+    ::tbb::enumerable_thread_specific<graph::partition_batch> partition_batches;
+
+    // with --numa batches of reads are spread over the NUMA nodes, their
+    // minimizers land in arena chunks local to the node detecting them,
+    // and nodes of the graph are merged by workers of the node that owns
+    // them by hash, so that each shard is first touched on its own node
+    ::std::optional<numa::node_arenas> numa_nodes;
+    ::tbb::task_group tg;
+
+    // bases are only needed to spell sequences, when memory is tight
+    // they are dropped as soon as the minimizers are known, so they are
+    // not put into the arena
+    ::std::pmr::memory_resource* bases_resource;
+
+    read_batch_t read_batch;
+    ::std::size_t read_batch_bases = 0;
+    batch_target target;
+    ::std::size_t read_batches = 0;
+    ::std::size_t bases = 0;
+
+    metrics::task_time detection_time, construction_time;
+
+    bool waited = false;
+    bool constructed = false;
+    bool flushed = false;
+
+    // unitigs once finished
+    graph::simplified_graph_t simplified;
+
+    explicit state(command_line_options const& options) noexcept
+      : opts(options),
+        batches([this] {
+          graph::construction_batch batch;
+          if (saved_unitigs) {
+            batch.touched.emplace();
+          }
+          return batch;
+        }) {
+      opts.resolve_defaults();
+
+      if (opts.max_memory && !opts.analysis) {
+        windows.emplace(opts.output_prefix + ".partitions");
+      }
+      if (opts.numa) {
+        numa_nodes.emplace(opts.threads);
+      }
+      bases_resource = windows && !opts.sequences
+        ? ::std::pmr::get_default_resource()
+        : &reads_arena;
+    }
+
+    // reads are numbered after the ones of a saved graph
+    processed_pair_t const& numbered(::std::size_t const read) const noexcept {
+      return processed[read - first_read];
+    }
+
+    void flush(graph::construction_batch& batch) noexcept {
+      if (!numa_nodes) {
+        graph::flush(graph, batch);
+        return;
+      }
+
+      auto const nodes = graph::detach(batch);
+      auto const parts = numa_nodes->size();
+      for (::std::size_t part = 0; part < parts; ++part) {
+        numa_nodes->run(part, [this, nodes, part, parts] {
+          trace::scope const traced{"flush"};
+          graph::flush(graph, *nodes, part, parts);
+        });
+      }
+    }
+
+    void construct(read_batch_t const& reads) noexcept {
+      construction_time.measure([&] {
+        trace::scope const traced{"construct"};
+        if (windows) {
+          for (auto const* ptr : reads) {
+            graph::construct(*windows, partition_batches.local(), ptr->second, opts);
+            progress.constructed();
+          }
+          return;
+        }
+
+        auto& batch = batches.local();
+        for (auto const* ptr : reads) {
+          graph::construct(batch, ptr->second, opts);
+          if (batch.full()) {
+            flush(batch);
+          }
+          progress.constructed();
+        }
+      });
+    }
+
+    void process(read_batch_t const& reads, ::std::size_t const index) noexcept {
+      detection_time.measure([&] {
+        trace::scope const traced{"detect_minimizers"};
+        for (::std::size_t i = 0; i < reads.size(); ++i) {
+          auto* const ptr = reads[i];
+          ptr->second = detect_minimizers(ptr->first, index + i, opts, &reads_arena);
+          progress.detected();
+
+          if (windows && !opts.sequences) {
+            ::std::pmr::string{}.swap(ptr->first);
+          }
+        }
+      });
+
+      if (!opts.analysis && !opts.remove_contained) {
+        construct(reads);
+      }
+    }
+
+    // only the pushing thread spawns tasks
+    void dispatch() noexcept {
+      auto const index = first_read + processed.size() - read_batch.size();
+      auto task = [this, index, reads = ::std::move(read_batch)] {
+        process(reads, index);
+      };
+
+      if (numa_nodes) {
+        numa_nodes->run(read_batches % numa_nodes->size(), ::std::move(task));
+      } else {
+        tg.run(::std::move(task));
+      }
+      read_batch.clear();
+      read_batch_bases = 0;
+      ++read_batches;
+    }
+
+    graph::minimizer_set_t touched() const noexcept {
+      graph::minimizer_set_t rv;
+      for (auto const& batch : batches) {
+        if (batch.touched) {
+          rv.insert(batch.touched->begin(), batch.touched->end());
+        }
+      }
+      return rv;
+    }
+
+    void push(::std::string_view const read) noexcept {
+      bases += read.size();
+      read_batch_bases += read.size();
+
+      // copied, callers usually reuse their buffer for the next read
+      processed.emplace_back(
+        ::std::pmr::string{read, bases_resource},
+        read_minimizers_t{&reads_arena});
+      read_batch.push_back(&processed.back());
+
+      if (read_batch_bases >= target.bases()) {
+        dispatch();
+        target.next();
+      }
+    }
+  };
+
+  assembler::assembler(command_line_options const& opts) noexcept
+    : self(::std::make_unique<state>(opts)) {}
+
+  assembler::~assembler() {
+    if (self && !self->waited) {
+      wait();
+    }
+  }
+
+  void assembler::on_progress(assembly_progress progress) noexcept {
+    self->progress = ::std::move(progress);
+  }
+
+  void assembler::resume(
+    ::std::size_t const reads,
+    graph::saved_unitigs_t unitigs
+  ) noexcept {
+    self->first_read = reads;
+    self->saved_unitigs = ::std::move(unitigs);
+  }
+
+  void assembler::push(::std::string_view const read) noexcept {
+    self->push(read);
+  }
+
+  void assembler::push(::std::vector<::std::string_view> const& reads) noexcept {
+    for (auto const read : reads) {
+      self->push(read);
+    }
+  }
+
+  void assembler::push(
+    ::std::string_view const bases,
+    ::std::vector<::std::size_t> const& ends
+  ) noexcept {
+    ::std::size_t begin = 0;
+    for (auto const end : ends) {
+      self->push(bases.substr(begin, end - begin));
+      begin = end;
+    }
+  }
+
+  void assembler::wait() noexcept {
+    if (!self->read_batch.empty()) {
+      self->dispatch();
+    }
+    if (self->numa_nodes) {
+      self->numa_nodes->wait();
+    } else {
+      self->tg.wait();
+    }
+    self->waited = true;
+  }
+
+  ::std::vector<bool> assembler::find_redundant(containment_stats& stats) const noexcept {
+    return ::mdbg::find_redundant(
+      self->processed.size(),
+      [this](auto const i) -> read_minimizers_t const& {
+        return self->processed[i].second;
+      },
+      stats);
+  }
+
+  void assembler::construct(::std::vector<bool> const& redundant) noexcept {
+    auto& processed = self->processed;
+    ::tbb::parallel_for(::tbb::blocked_range<::std::size_t>(0, processed.size()),
+      [this, &processed, &redundant](auto const& range) {
+        read_batch_t kept;
+        for (auto i = range.begin(); i != range.end(); ++i) {
+          if (redundant[i]) {
+            self->progress.constructed();
+          } else {
+            kept.push_back(&processed[i]);
+          }
+        }
+        self->construct(kept);
+      });
+    self->constructed = true;
+  }
+
+  void assembler::flush() noexcept {
+    ::tbb::parallel_for_each(self->batches.begin(), self->batches.end(), [this](auto& batch) {
+      trace::scope const traced{"flush"};
+      self->flush(batch);
+    });
+    if (self->numa_nodes) {
+      self->numa_nodes->wait();
+    }
+    if (self->windows) {
+      for (auto& batch : self->partition_batches) {
+        graph::flush(*self->windows, batch);
+      }
+    }
+    self->flushed = true;
+  }
+
+  assembly assembler::finish(assembly_hooks const& hooks) noexcept {
+    auto const& opts = self->opts;
+    auto& graph = self->graph;
+    auto& simplified = self->simplified;
+
+    if (!self->waited) {
+      wait();
+    }
+    if (opts.remove_contained && !self->constructed) {
+      containment_stats stats;
+      construct(find_redundant(stats));
+    }
+    if (!self->flushed) {
+      flush();
+    }
+
+    if (self->windows) {
+      graph::partition_stats stats;
+      hooks.begin("partitioned_assembly");
+      simplified = graph::assemble_partitioned(
+        *self->windows,
+        [this](auto const i) -> read_minimizers_t const& {
+          return self->numbered(i).second;
+        },
+        opts.max_memory, opts, stats);
+      hooks.end();
+
+      // removes the buckets from disk
+      self->windows.reset();
+      hooks.partitioned(stats);
+      hooks.simplified(simplified);
+
+      return assembly{::std::move(self)};
+    }
+
+    hooks.constructed(graph);
+
+    if (opts.min_abundance > 1) {
+      hooks.begin("abundance_filter");
+      auto const removed = graph::remove_low_abundance(graph, opts.min_abundance);
+      hooks.end();
+      hooks.filtered(removed);
+    }
+
+    // the partition is simplified together with the others by 'mdbg merge'
+    if (opts.partitions > 1) {
+      return assembly{::std::move(self)};
+    }
+
+    hooks.begin("simplify");
+    if (self->saved_unitigs) {
+      graph::incremental_stats stats;
+      simplified = graph::simplify_incremental(
+        graph, *self->saved_unitigs, self->touched(), stats);
+      hooks.end();
+      hooks.recomputed(stats);
+    } else {
+      simplified = graph::simplify(graph);
+      hooks.end();
+    }
+    hooks.simplified(simplified);
+
+    if (opts.clip_tips || opts.pop_bubbles || opts.break_loops) {
+      hooks.begin("cleanup");
+      auto const cleaned = graph::clean(graph, simplified, opts);
+      hooks.end();
+      hooks.cleaned(cleaned, simplified);
+    }
+
+    return assembly{::std::move(self)};
+  }
+
+  load_stats assembler::stats() const noexcept {
+    load_stats stats{
+      self->detection_time.ms(),
+      self->construction_time.ms(),
+      self->read_batches,
+      self->bases,
+      self->reads_arena.reserved(),
+      0, 0};
+
+    for (auto const& batch : self->batches) {
+      stats.batch_windows += batch.windows;
+      stats.batch_hits += batch.hits;
+    }
+    return stats;
+  }
+
+  ::std::size_t assembler::numa_nodes() const noexcept {
+    return self->numa_nodes ? self->numa_nodes->size() : 0;
+  }
+
+  ::std::size_t assembler::reads() const noexcept {
+    return self->processed.size();
+  }
+
+  ::std::string_view assembler::read(::std::size_t const i) const noexcept {
+    return self->processed[i].first;
+  }
+
+  read_minimizers_t const& assembler::read_minimizers(::std::size_t const i) const noexcept {
+    return self->processed[i].second;
+  }
+
+  graph::de_bruijn_graph_t& assembler::graph() noexcept {
+    return self->graph;
+  }
+
+  assembly::assembly(::std::unique_ptr<assembler::state> state) noexcept
+    : self(::std::move(state)) {}
+
+  assembly::~assembly() = default;
+  assembly::assembly(assembly&&) noexcept = default;
+  assembly& assembly::operator=(assembly&&) noexcept = default;
+
+  graph::simplified_graph_t const& assembly::unitigs() const noexcept {
+    return self->simplified;
+  }
+
+  graph::de_bruijn_graph_t const& assembly::graph() const noexcept {
+    return self->graph;
+  }
+
+  ::std::size_t assembly::length(unitig const& u) const noexcept {
+    return graph::unitig_length(u.second, self->opts);
+  }
+
+  void assembly::write_gfa(::std::ostream& out) const noexcept {
+    graph::write_gfa(
+      out,
+      self->simplified,
+      [this](auto&& i) -> ::std::string_view { return read(i); },
+      self->opts);
+  }
+
+  command_line_options const& assembly::options() const noexcept {
+    return self->opts;
+  }
+
+  ::std::string_view assembly::read(::std::size_t const i) const noexcept {
+    if (i < self->first_read) {
+      ::mdbg::terminate("the bases of the reads of a saved graph are not kept");
+    }
+    if (self->bases_resource != &self->reads_arena) {
+      ::mdbg::terminate("unitigs are only spelled with opts.max_memory when opts.sequences is set");
+    }
+    return self->numbered(i).first;
+  }
+
+}
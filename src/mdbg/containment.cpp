@@ -0,0 +1,111 @@
+#include <mdbg/containment.hpp>
+#include <mdbg/util.hpp>
+
+#include <tsl/robin_map.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <numeric>
+
+namespace mdbg {
+
+  namespace {
+
+    // occurrences of a minimizer are chained through the kept reads,
+    // the last one seen first
+    struct occurrence {
+      ::std::uint32_t read;
+      ::std::uint32_t position;
+      ::std::size_t next;
+    };
+
+    ::std::size_t constexpr none = ::std::numeric_limits<::std::size_t>::max();
+
+    // occurrences of the first minimizer compared with a read at most,
+    // bounds the work on minimizers repeated in many reads
+    ::std::size_t constexpr max_candidates = 64;
+
+    // is 'read' found in 'other' forward from 'position', or backward
+    // from it, as read on the opposite strand
+    bool found_at(
+      read_minimizers_t const& read,
+      read_minimizers_t const& other,
+      ::std::size_t const position
+    ) noexcept {
+      auto const n = read.size();
+
+      auto forward = position + n <= other.size();
+      for (::std::size_t i = 0; forward && i < n; ++i) {
+        forward = other[position + i].minimizer == read[i].minimizer;
+      }
+      if (forward) {
+        return true;
+      }
+
+      auto backward = position + 1 >= n;
+      for (::std::size_t i = 0; backward && i < n; ++i) {
+        backward = other[position - i].minimizer == read[i].minimizer;
+      }
+      return backward;
+    }
+
+  }
+
+  ::std::vector<bool> find_redundant(
+    ::std::size_t const reads,
+    read_minimizers_index_t const& index,
+    containment_stats& stats
+  ) noexcept {
+    if (reads > ::std::numeric_limits<::std::uint32_t>::max()) {
+      ::mdbg::terminate("Containment is checked for up to 2^32 reads.");
+    }
+
+    ::std::vector<bool> rv(reads);
+
+    ::std::vector<::std::uint32_t> order(reads);
+    ::std::iota(order.begin(), order.end(), 0);
+    ::std::stable_sort(order.begin(), order.end(), [&index](auto const l, auto const r) {
+      return index(l).size() > index(r).size();
+    });
+
+    ::tsl::robin_map<::std::uint64_t, ::std::size_t> last;
+    ::std::vector<occurrence> occurrences;
+
+    for (auto const id : order) {
+      auto const& read = index(id);
+      if (read.empty()) {
+        continue;
+      }
+
+      auto const first = last.find(read.front().minimizer);
+      auto candidate = first == last.end() ? none : first->second;
+
+      for (::std::size_t checked = 0; 
+           candidate != none && checked < max_candidates; ++checked) {
+        auto const& [other, position, next] = occurrences[candidate];
+        auto const& other_read = index(other);
+
+        if (found_at(read, other_read, position)) {
+          ++(other_read.size() == read.size() ? stats.duplicates : stats.contained);
+          rv[id] = true;
+          break;
+        }
+        candidate = next;
+      }
+
+      if (rv[id]) {
+        continue;
+      }
+
+      for (::std::size_t i = 0; i < read.size(); ++i) {
+        auto& head = last.try_emplace(read[i].minimizer, none).first.value();
+        occurrences.push_back({id, static_cast<::std::uint32_t>(i), head});
+        head = occurrences.size() - 1;
+      }
+    }
+
+    return rv;
+  }
+
+}
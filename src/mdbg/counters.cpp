@@ -0,0 +1,103 @@
+#include <mdbg/counters.hpp>
+
+#ifdef MDBG_COUNTERS
+
+#include <algorithm>
+
+#include <tbb/enumerable_thread_specific.h>
+
+namespace mdbg::counters {
+
+  namespace {
+
+    using all_counters_t = ::tbb::enumerable_thread_specific<local_counters>;
+
+    all_counters_t& all() noexcept {
+      static all_counters_t counters;
+      return counters;
+    }
+
+    char const* counter_names[] = {
+      "insert_hit",
+      "insert_miss",
+      "accessor_wait_ns",
+      "edge_set_resize",
+      "duplicate_unitig",
+      "duplicate_unitig_nodes"
+    };
+
+    char const* histogram_names[] = {
+      "accessor_wait_ns",
+      "unitig_length"
+    };
+
+    static_assert(
+      sizeof(counter_names) / sizeof(*counter_names)
+        == static_cast<::std::size_t>(counter::size));
+    static_assert(
+      sizeof(histogram_names) / sizeof(*histogram_names)
+        == static_cast<::std::size_t>(histogram::size));
+
+  }
+
+  local_counters& local() noexcept {
+    // the lookup in enumerable_thread_specific hashes the thread id,
+    // cache the result since this sits on the hottest paths
+    thread_local local_counters* cached = &all().local();
+    return *cached;
+  }
+
+  ::std::uint64_t total(counter const c) noexcept {
+    ::std::uint64_t sum = 0;
+    for (auto const& counters : all()) {
+      sum += counters.values[static_cast<::std::size_t>(c)]
+        .load(::std::memory_order_relaxed);
+    }
+    return sum;
+  }
+
+  void print(FILE* out) noexcept {
+    ::std::fprintf(out, "counters:\n");
+    for (::std::size_t c = 0; c < static_cast<::std::size_t>(counter::size); ++c) {
+      ::std::fprintf(out, "  %-24s %lu\n",
+        counter_names[c], total(static_cast<counter>(c)));
+    }
+
+    for (::std::size_t h = 0; h < static_cast<::std::size_t>(histogram::size); ++h) {
+      ::std::array<::std::uint64_t, histogram_buckets> merged = {};
+      ::std::uint64_t largest = 0;
+
+      for (auto const& counters : all()) {
+        for (::std::size_t b = 0; b < histogram_buckets; ++b) {
+          merged[b] += counters.histograms[h][b].load(::std::memory_order_relaxed);
+        }
+      }
+      for (auto const count : merged) {
+        largest = ::std::max(largest, count);
+      }
+
+      ::std::fprintf(out, "histogram %s:\n", histogram_names[h]);
+      if (largest == 0) {
+        continue;
+      }
+
+      for (::std::size_t b = 0; b < histogram_buckets; ++b) {
+        if (merged[b] == 0) {
+          continue;
+        }
+
+        ::std::fprintf(out, "  [%10lu, %10lu) %10lu ",
+          b == 0 ? 0ul : 1ul << b, 1ul << (b + 1), merged[b]);
+        for (auto i = merged[b] * 40 / largest; i > 0; --i) {
+          ::std::fputc('#', out);
+        }
+        ::std::fputc('\n', out);
+      }
+    }
+
+    ::std::fflush(out);
+  }
+
+}
+
+#endif
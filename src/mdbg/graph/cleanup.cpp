@@ -0,0 +1,359 @@
+#include <mdbg/graph/cleanup.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#include <tsl/robin_set.h>
+#include <tbb/concurrent_vector.h>
+#include <tbb/parallel_for.h>
+
+namespace mdbg::graph {
+
+  namespace {
+
+    using node_list_t = ::tbb::concurrent_vector<detail::compact_minimizer>;
+
+    void append_nodes(
+      node_list_t& nodes,
+      simplified_graph_t::mapped_type const& unitig_nodes
+    ) noexcept {
+      for (auto const& current : unitig_nodes) {
+        nodes.push_back(current.node.first);
+      }
+    }
+
+    void remove_all(de_bruijn_graph_t& dbg, node_list_t const& nodes) noexcept {
+      remove_nodes(dbg, {nodes.begin(), nodes.end()});
+    }
+
+    // only edge leaving the given oriented node
+    detail::oriented_minimizer single_out_edge(
+      unitig_node const& tail,
+      bool const reverse
+    ) noexcept {
+      detail::oriented_minimizer rv;
+      tail.node.second.for_each_out_edge(reverse, [&rv](auto const& to) { rv = to; });
+      return rv;
+    }
+
+  }
+
+  ::std::size_t clip_tips(
+    de_bruijn_graph_t& dbg,
+    simplified_graph_t const& graph,
+    ::std::size_t const max_length,
+    command_line_options const& opts
+  ) noexcept {
+    struct tip_info {
+      simplified_graph_t::mapped_type const* unitig_nodes;
+      detail::oriented_minimizer start;
+      ::std::size_t length;
+      double coverage;
+
+      // nodes the tip joins, each with its number of predecessors
+      ::std::vector<::std::pair<detail::oriented_minimizer, ::std::size_t>> junctions;
+    };
+
+    ::tbb::concurrent_vector<tip_info> tips;
+
+    ::tbb::parallel_for(
+      graph.range(),
+      [&](simplified_graph_t::const_range_type const& range) {
+        de_bruijn_graph_t::const_accessor accessor;
+
+        for (auto const& [starting_minimizer, unitig_nodes] : range) {
+          auto const& back = unitig_nodes.back();
+          auto const& front = unitig_nodes.front();
+
+          auto const dead_end = back.node.second.out_degree(back.reverse) == 0;
+          auto const dead_start = front.node.second.out_degree(!front.reverse) == 0;
+
+          if (dead_end == dead_start) {
+            continue;
+          }
+
+          auto const length = unitig_length(unitig_nodes, opts);
+          if (length >= max_length) {
+            continue;
+          }
+
+          auto const& tail = dead_end ? front : back;
+          auto const reverse = dead_end ? !front.reverse : back.reverse;
+
+          tip_info tip{&unitig_nodes, starting_minimizer, length, 0, {}};
+
+          bool attached = true;
+          tail.node.second.for_each_out_edge(reverse, [&](auto const& to) {
+            attached = attached
+              && dbg.find(accessor, to.key()) 
+              && accessor->second.in_degree(to.reverse) > 1;
+            if (attached) {
+              tip.junctions.emplace_back(to, accessor->second.in_degree(to.reverse));
+            }
+          });
+
+          if (!attached) {
+            continue;
+          }
+
+          for (auto const& n : unitig_nodes) {
+            tip.coverage += n.node.second.count;
+          }
+          tip.coverage /= static_cast<double>(unitig_nodes.size());
+          tips.push_back(::std::move(tip));
+        }
+      });
+
+    // tips are decided against the graph they were found in, so where
+    // all predecessors of a node are tips, such as the differing ends of
+    // reads at the end of a chromosome, the longest and then best covered
+    // one stays
+    struct junction_info {
+      ::std::size_t in_degree;
+      ::std::vector<::std::size_t> tips;
+    };
+
+    oriented_minimizer_map_t<junction_info> junctions;
+    for (::std::size_t i = 0; i < tips.size(); ++i) {
+      for (auto const& [junction, in_degree] : tips[i].junctions) {
+        auto& entering = junctions[junction];
+        entering.in_degree = in_degree;
+        entering.tips.push_back(i);
+      }
+    }
+
+    auto const better = [&tips](::std::size_t const l, ::std::size_t const r) {
+      auto const& a = tips[l];
+      auto const& b = tips[r];
+      return ::std::tie(a.length, a.coverage, b.start) 
+        > ::std::tie(b.length, b.coverage, a.start);
+    };
+
+    ::std::vector<bool> kept(tips.size(), false);
+    for (auto const& [junction, entering] : junctions) {
+      if (entering.tips.size() >= entering.in_degree) {
+        kept[*::std::min_element(entering.tips.begin(), entering.tips.end(), better)] = true;
+      }
+    }
+
+    node_list_t to_remove;
+    ::std::size_t clipped = 0;
+
+    for (::std::size_t i = 0; i < tips.size(); ++i) {
+      if (!kept[i]) {
+        append_nodes(to_remove, *tips[i].unitig_nodes);
+        ++clipped;
+      }
+    }
+
+    remove_all(dbg, to_remove);
+    return clipped;
+  }
+
+  ::std::size_t pop_bubbles(
+    de_bruijn_graph_t& dbg,
+    simplified_graph_t const& graph,
+    ::std::size_t const max_length,
+    command_line_options const& opts
+  ) noexcept {
+    // bounds the search for an alternative path
+    ::std::size_t constexpr max_visited = 64;
+
+    struct segment_info {
+      simplified_graph_t::mapped_type const* unitig_nodes;
+      ::std::size_t length;
+      double coverage;
+    };
+
+    auto const segments = index_segments(graph);
+
+    ::std::vector<segment_info> info;
+    for (auto const& [starting_minimizer, unitig_nodes] : graph) {
+      info.push_back({&unitig_nodes, 0, 0});
+    }
+
+    ::tbb::parallel_for(
+      ::std::size_t{0}, info.size(),
+      [&info, &opts](::std::size_t const i) {
+        auto& current = info[i];
+        double count = 0;
+        for (auto const& n : *current.unitig_nodes) {
+          count += n.node.second.count;
+        }
+        current.length = unitig_length(*current.unitig_nodes, opts);
+        current.coverage = count / static_cast<double>(current.unitig_nodes->size());
+      });
+
+    // is there a path from 'from' to 'to' through segments covered strictly
+    // better than 'coverage', not longer than 'remaining' bases
+    auto const alternative_path = [&segments, &info](
+      auto const& self,
+      detail::oriented_minimizer const& from,
+      detail::oriented_minimizer const& to,
+      ::std::size_t const skip,
+      double const coverage,
+      ::std::size_t const remaining,
+      ::std::size_t& visited
+    ) -> bool {
+      if (from == to) {
+        return true;
+      }
+
+      auto const iter = segments.find(from);
+      if (iter == segments.end() || ++visited > max_visited) {
+        return false;
+      }
+
+      auto const [segment, reverse] = iter->second;
+      auto const& current = info[segment];
+
+      if (segment == skip 
+            || current.coverage <= coverage 
+            || current.length > remaining) {
+        return false;
+      }
+
+      auto const& tail = 
+        reverse ? current.unitig_nodes->front() : current.unitig_nodes->back();
+
+      bool found = false;
+      tail.node.second.for_each_out_edge(tail.reverse != reverse, [&](auto const& next) {
+        found = found 
+          || self(self, next, to, skip, coverage, remaining - current.length, visited);
+      });
+
+      return found;
+    };
+
+    node_list_t to_remove;
+    ::std::atomic<::std::size_t> popped = 0;
+
+    ::tbb::parallel_for(
+      ::std::size_t{0}, info.size(),
+      [&](::std::size_t const i) {
+        auto const& branch = info[i];
+        auto const& back = branch.unitig_nodes->back();
+        auto const& front = branch.unitig_nodes->front();
+
+        if (branch.length >= max_length
+              || back.node.second.out_degree(back.reverse) != 1
+              || front.node.second.out_degree(!front.reverse) != 1) {
+          return;
+        }
+
+        auto const entry = detail::oriented_minimizer{
+          front.node.first.cached_hash, front.reverse};
+        auto const source = single_out_edge(front, !front.reverse).flip();
+        auto const sink = single_out_edge(back, back.reverse);
+
+        de_bruijn_graph_t::const_accessor accessor;
+        if (!dbg.find(accessor, source.key())) {
+          return;
+        }
+
+        // an edge straight from source to sink is weighed by the source count
+        auto const direct_coverage = static_cast<double>(accessor->second.count);
+
+        bool found = false;
+        accessor->second.for_each_out_edge(source.reverse, [&](auto const& next) {
+          if (found || next == entry) {
+            return;
+          }
+
+          ::std::size_t visited = 0;
+          found = next == sink 
+            ? direct_coverage > branch.coverage
+            : alternative_path(
+                alternative_path, next, sink, i, 
+                branch.coverage, max_length, visited);
+        });
+
+        if (found) {
+          append_nodes(to_remove, *branch.unitig_nodes);
+          ++popped;
+        }
+      });
+
+    remove_all(dbg, to_remove);
+    return popped;
+  }
+
+  ::std::size_t break_loops(
+    de_bruijn_graph_t& dbg,
+    simplified_graph_t const& graph
+  ) noexcept {
+    auto const segments = index_segments(graph);
+
+    ::std::vector<::std::pair<detail::oriented_minimizer, detail::oriented_minimizer>> 
+      to_remove;
+    ::tsl::robin_set<::std::size_t> seen;
+
+    for_each_link(graph, segments, [&](segment_link const& link) {
+      auto const [l, r] = ::std::minmax(link.from, link.to);
+      // segment ids are dense, so the pair packs into a single key
+      auto const key = l * segments.size() + r;
+
+      if (l == r || !seen.insert(key).second) {
+        to_remove.emplace_back(link.tail_node, link.target);
+      }
+    });
+
+    for (auto const& [from, to] : to_remove) {
+      remove_edge(dbg, from, to);
+    }
+
+    return to_remove.size();
+  }
+
+  cleanup_stats clean(
+    de_bruijn_graph_t& dbg,
+    simplified_graph_t& graph,
+    command_line_options const& opts
+  ) noexcept {
+    cleanup_stats stats;
+
+    auto const run = [&dbg, &graph](::std::size_t& total, auto&& pass) {
+      auto const removed = pass();
+      if (removed) {
+        total += removed;
+        graph = simplify(dbg);
+      }
+      return removed;
+    };
+
+    auto const clip_and_pop = [&] {
+      for (;;) {
+        ::std::size_t changed = 0;
+
+        if (opts.clip_tips) {
+          changed += run(stats.tips, [&] {
+            return clip_tips(dbg, graph, opts.clip_tips, opts);
+          });
+        }
+
+        if (opts.pop_bubbles) {
+          changed += run(stats.bubbles, [&] {
+            return pop_bubbles(dbg, graph, opts.pop_bubbles, opts);
+          });
+        }
+
+        if (!changed) {
+          break;
+        }
+      }
+    };
+
+    clip_and_pop();
+
+    if (opts.break_loops 
+          && run(stats.loops, [&] { return break_loops(dbg, graph); })) {
+      clip_and_pop();
+    }
+
+    return stats;
+  }
+
+}
@@ -1,4 +1,5 @@
 #include <mdbg/opt.hpp>
+#include <mdbg/counters.hpp>
 #include <mdbg/graph/construction.hpp>
 #include <mdbg/util.hpp>
 
@@ -7,10 +8,15 @@
 #include <cstdint>
 #include <functional>
 
+#include <tbb/enumerable_thread_specific.h>
+#include <tbb/parallel_reduce.h>
+
 namespace mdbg::graph {
 
   namespace detail {
 
+    // windows with equal hashes whose minimizers differ, compared in
+    // the canonical orientation of both
     inline bool collision(
       compact_minimizer const& l, compact_minimizer const& r,
       ::std::size_t const length
@@ -19,11 +25,10 @@ namespace mdbg::graph {
         return false;
       }
 
-      auto l_iter = l.minimizer;
-      auto r_iter = r.minimizer;
-      
       for (::std::size_t i = 0; i < length; ++i) {
-        if ((l_iter++)->minimizer != (r_iter++)->minimizer) {
+        auto const j = l.reverse == r.reverse ? i : length - 1 - i;
+        if (l.minimizer[static_cast<::std::ptrdiff_t>(i)].minimizer 
+            != r.minimizer[static_cast<::std::ptrdiff_t>(j)].minimizer) {
           return true;
         }
       }
@@ -33,57 +38,226 @@ namespace mdbg::graph {
 
   }
 
+  namespace {
+
+    struct collision_check {
+      bool enabled = false;
+      bool all = false;
+      // sampled windows collapse to a value at most this
+      ::std::uint64_t threshold = 0;
+      ::std::size_t length = 0;
+    } checking;
+
+    ::tbb::enumerable_thread_specific<collision_stats> checked;
+
+    // 'window' was merged into the node keyed by 'node'
+    void verify(
+      detail::compact_minimizer const& node,
+      detail::compact_minimizer const& window
+    ) noexcept {
+      if (!checking.enabled
+          || (!checking.all && window.cached_hash.collapse() > checking.threshold)) {
+        return;
+      }
+
+      auto& local = checked.local();
+      ++local.checked;
+      local.collisions += detail::collision(node, window, checking.length);
+    }
+
+  }
+
+  void check_collisions(command_line_options const& opts) noexcept {
+    checking.enabled = opts.check_collisions > 0;
+    checking.all = opts.check_collisions >= 1;
+    checking.threshold = static_cast<::std::uint64_t>(opts.check_collisions 
+      * static_cast<double>(::std::numeric_limits<::std::uint64_t>::max()));
+    checking.length = opts.k - 1;
+  }
+
+  collision_stats collisions() noexcept {
+    collision_stats rv;
+    for (auto const& local : checked) {
+      rv.checked += local.checked;
+      rv.collisions += local.collisions;
+    }
+    return rv;
+  }
+
+  namespace {
+
+    void insert_edge(detail::dbg_node& node, detail::dbg_edge const& edge) noexcept {
+      if constexpr (::mdbg::counters::enabled) {
+        auto const buckets = node.edges.bucket_count();
+        node.edges.insert(edge);
+        if (node.edges.bucket_count() != buckets) {
+          ::mdbg::counters::add(::mdbg::counters::counter::edge_set_resize);
+        }
+      } else {
+        node.edges.insert(edge);
+      }
+    }
+
+    // merges a batch node into the shared graph, where the edge sets of
+    // the busiest nodes grow
+    void merge_node(detail::dbg_node& node, detail::dbg_node const& other) noexcept {
+      if constexpr (::mdbg::counters::enabled) {
+        auto const buckets = node.edges.bucket_count();
+        node.merge(other);
+        if (node.edges.bucket_count() != buckets) {
+          ::mdbg::counters::add(::mdbg::counters::counter::edge_set_resize);
+        }
+      } else {
+        node.merge(other);
+      }
+    }
+
+    // inserts a node under the accessor, counting hits and wait time
+    template<typename Accessor>
+    void insert_node(
+      de_bruijn_graph_t& graph,
+      Accessor& accessor,
+      detail::compact_minimizer const& window
+    ) noexcept {
+      auto const inserted = ::mdbg::counters::time_accessor([&] {
+        return graph.insert(accessor, {window, {}});
+      });
+
+      if (!inserted) {
+        verify(accessor->first, window);
+      }
+
+      ::mdbg::counters::add(inserted
+        ? ::mdbg::counters::counter::insert_miss
+        : ::mdbg::counters::counter::insert_hit);
+    }
+
+    // walks the windows of a read, 'node' inserts a window into the
+    // graph if needed and returns its node; the returned reference only
+    // has to stay valid until the next call
+    template<typename NodeOf>
+    void insert_windows(
+      read_minimizers_t const& read_minimizers,
+      command_line_options const& opts,
+      NodeOf&& node_of
+    ) noexcept {
+      detail::dbg_node* node = nullptr;
+      detail::compact_minimizer prefix;
+
+      for_each_window(
+        read_minimizers, opts,
+        [&node, &prefix, &node_of](detail::compact_minimizer const& window) {
+          if (node != nullptr) {
+            insert_edge(*node, {
+              prefix.reverse, 
+              {window.cached_hash, window.reverse}
+            });
+          }
+
+          auto& current = node_of(window);
+          current.increment();
+
+          // same edge as seen from the opposite strand
+          if (node != nullptr) {
+            insert_edge(current, {
+              !window.reverse,
+              {prefix.cached_hash, !prefix.reverse}
+            });
+          }
+
+          node = &current;
+          prefix = window;
+        });
+    }
+
+  }
+
   void construct(
     de_bruijn_graph_t& graph,
     read_minimizers_t const& read_minimizers,
     command_line_options const& opts
   ) noexcept {
-    if (opts.k < 3) {
-      ::mdbg::terminate("k should be at least 3");
-    }
-    auto const overlap_length = opts.k - 1;
+    de_bruijn_graph_t::accessor accessor;
+
+    insert_windows(
+      read_minimizers, opts,
+      [&graph, &accessor](auto const& window) -> detail::dbg_node& {
+        insert_node(graph, accessor, window);
+        return accessor->second;
+      });
+  }
+
+  void construct(
+    construction_batch& batch,
+    read_minimizers_t const& read_minimizers,
+    command_line_options const& opts
+  ) noexcept {
+    insert_windows(
+      read_minimizers, opts,
+      [&batch, &opts](auto const& window) -> detail::dbg_node& {
+        // edges into other partitions are kept, their nodes are not
+        if (opts.partitions > 1 
+            && partition_of(window.cached_hash, opts.partitions) != opts.partition) {
+          batch.foreign.edges.clear();
+          return batch.foreign;
+        }
+        auto const [node, inserted] = batch.nodes.try_emplace(window);
+        ++batch.windows;
+        if (!inserted) {
+          verify(node->first, window);
+          ++batch.hits;
+        }
+        return node.value();
+      });
+  }
 
-    if (read_minimizers.size() < opts.k) {
-      return;
+  namespace {
+
+    void record_touched(construction_batch& batch) noexcept {
+      if (batch.touched) {
+        for (auto const& [window, node] : batch.nodes) {
+          batch.touched->insert(window);
+        }
+      }
     }
 
-    detail::compact_minimizer current_window{
-      read_minimizers.begin(),
-      {}
-    };
+  }
 
-    for (::std::size_t i = 0; i < overlap_length; ++i) {
-      current_window.cached_hash.advance(read_minimizers[i].minimizer);
+  void flush(de_bruijn_graph_t& graph, construction_batch& batch) noexcept {
+    de_bruijn_graph_t::accessor accessor;
+
+    for (auto const& [window, node] : batch.nodes) {
+      insert_node(graph, accessor, window);
+      merge_node(accessor->second, node);
     }
 
+    accessor.release();
+
+    record_touched(batch);
+    batch.nodes.clear();
+  }
+
+  ::std::shared_ptr<batch_nodes_t const> detach(construction_batch& batch) noexcept {
+    record_touched(batch);
+
+    auto rv = ::std::make_shared<batch_nodes_t const>(::std::move(batch.nodes));
+    batch.nodes.clear();
+    return rv;
+  }
+
+  void flush(
+    de_bruijn_graph_t& graph,
+    batch_nodes_t const& nodes,
+    ::std::size_t const part,
+    ::std::size_t const parts
+  ) noexcept {
     de_bruijn_graph_t::accessor accessor;
-    graph.insert(accessor, {current_window, {}});
-    
-    for (::std::size_t i = 1; 
-         i < read_minimizers.size() - overlap_length + 1; ++i) {
-
-      ++current_window.minimizer;
-      current_window.cached_hash.rotate(
-        read_minimizers[i + overlap_length - 1].minimizer,
-        read_minimizers[i - 1].minimizer,
-        overlap_length
-      );
-
-      auto prefix_minimizer = accessor->first;
-      auto& prefix_node = accessor->second;
-
-      prefix_node.out_edges.insert(current_window);
-
-      graph.insert(accessor, {current_window, {}});
-
-      auto& suffix_node = accessor->second;
-      if (!suffix_node.fan_in && suffix_node.last_in.has_value() 
-            && suffix_node.last_in.value().cached_hash 
-                != prefix_minimizer.cached_hash) {
-        suffix_node.fan_in = true;
-      }
 
-      suffix_node.last_in = prefix_minimizer;
+    for (auto const& [window, node] : nodes) {
+      if (partition_of(window.cached_hash, parts) == part) {
+        insert_node(graph, accessor, window);
+        merge_node(accessor->second, node);
+      }
     }
   }
 
@@ -98,4 +272,18 @@ namespace mdbg::graph {
     }
   }
 
+  ::std::size_t count_edges(de_bruijn_graph_t const& graph) noexcept {
+    auto const halves = ::tbb::parallel_reduce(
+      graph.range(), ::std::size_t{0},
+      [](de_bruijn_graph_t::const_range_type const& range, ::std::size_t sum) {
+        for (auto const& [minimizer, node] : range) {
+          sum += node.edges.size();
+        }
+        return sum;
+      },
+      ::std::plus<::std::size_t>{});
+
+    return halves / 2;
+  }
+
 }
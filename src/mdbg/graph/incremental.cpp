@@ -0,0 +1,176 @@
+#include <mdbg/graph/incremental.hpp>
+
+#include <tbb/blocked_range.h>
+#include <tbb/parallel_for.h>
+#include <tbb/parallel_for_each.h>
+
+#include <algorithm>
+#include <atomic>
+#include <optional>
+#include <vector>
+
+namespace mdbg::graph {
+
+  namespace {
+
+    using node_t = de_bruijn_graph_t::value_type;
+
+    // the graph is not modified while it is simplified, so nodes stay
+    // where they are after their accessor is released
+    node_t const* find(de_bruijn_graph_t const& dbg, ::mdbg::node_hash const& hash) noexcept {
+      de_bruijn_graph_t::const_accessor accessor;
+      return dbg.find(accessor, {{}, hash, false}) ? &*accessor : nullptr;
+    }
+
+    // walks back from an oriented node to where simplify starts the
+    // unitig holding it: a node entered by several edges or none, or
+    // whose only predecessor leaves it by several; nullopt when the walk
+    // comes back around, cycles without such a node have no unitig
+    ::std::optional<detail::oriented_minimizer> unitig_start(
+      de_bruijn_graph_t const& dbg,
+      node_t const* node,
+      detail::oriented_minimizer const& origin
+    ) noexcept {
+      auto current = origin;
+
+      for (;;) {
+        if (node->second.in_degree(current.reverse) != 1) {
+          return current;
+        }
+
+        detail::oriented_minimizer previous;
+        node->second.for_each_out_edge(
+          !current.reverse, [&previous](auto const& to) { previous = to.flip(); });
+
+        if (previous == origin) {
+          return ::std::nullopt;
+        }
+
+        // walks from the start stop when they get back to its node
+        if (previous.cached_hash == origin.cached_hash) {
+          return current;
+        }
+
+        auto const* previous_node = find(dbg, previous.cached_hash);
+        if (previous_node == nullptr
+            || previous_node->second.out_degree(previous.reverse) != 1) {
+          return current;
+        }
+
+        current = previous;
+        node = previous_node;
+      }
+    }
+
+  }
+
+  simplified_graph_t simplify_incremental(
+    de_bruijn_graph_t const& dbg,
+    saved_unitigs_t const& previous,
+    minimizer_set_t const& touched,
+    incremental_stats& stats
+  ) noexcept {
+    // touched nodes changed their count or edges, their neighbours may
+    // have gained edges to nodes that now pass the abundance filter
+    minimizer_set_t dirty;
+
+    for (auto const& minimizer : touched) {
+      auto const* node = find(dbg, minimizer.cached_hash);
+      if (node == nullptr) {
+        continue;
+      }
+
+      dirty.insert(minimizer);
+      for (auto const& edge : node->second.edges) {
+        dirty.insert(edge.to.key());
+      }
+    }
+
+    simplified_graph_t simplified;
+
+    ::tbb::parallel_for(::tbb::blocked_range<::std::size_t>(0, previous.size()),
+      [&](auto const& range) {
+        for (auto i = range.begin(); i != range.end(); ++i) {
+          auto const& unitig_nodes = previous[i];
+          auto const clean = ::std::none_of(
+            unitig_nodes.begin(), unitig_nodes.end(),
+            [&dirty](auto const& node) { return dirty.count(node.key()); });
+
+          if (!clean) {
+            continue;
+          }
+
+          simplified_graph_t::mapped_type rebuilt;
+          rebuilt.reserve(unitig_nodes.size());
+
+          for (auto const& node : unitig_nodes) {
+            auto const* current = find(dbg, node.cached_hash);
+            if (current == nullptr) {
+              ::mdbg::terminate("saved unitigs do not match the saved graph");
+            }
+            rebuilt.push_back({*current, node.reverse});
+          }
+
+          simplified.insert({unitig_nodes.front(), ::std::move(rebuilt)});
+        }
+      });
+
+    stats.touched = touched.size();
+    stats.dirty = dirty.size();
+    stats.kept = simplified.size();
+
+    // every other unitig holds a dirty node, so they are walked from the
+    // dirty nodes over the graph; nodes already walked are skipped
+    ::std::vector<detail::compact_minimizer> const starts(dirty.begin(), dirty.end());
+    concurrent_oriented_map_t<bool> walked;
+    ::std::atomic<::std::size_t> recomputed = 0;
+
+    auto const lookup = [&dbg](auto const& hash) { return find(dbg, hash); };
+
+    ::tbb::parallel_for_each(starts.begin(), starts.end(),
+      [&](detail::compact_minimizer const& minimizer) {
+        auto const* node = find(dbg, minimizer.cached_hash);
+        if (node == nullptr) {
+          return;
+        }
+
+        for (auto const reverse : {false, true}) {
+          if (walked.count({minimizer.cached_hash, false})) {
+            return;
+          }
+
+          auto start = unitig_start(dbg, node, {minimizer.cached_hash, reverse});
+          if (!start) {
+            continue;
+          }
+
+          auto chain = walk_unitig(lookup, *start);
+          auto const& [last, last_reverse] = chain.back();
+
+          // keeps the strand simplify keeps, the one starting with the
+          // smaller node
+          auto const reverse_start =
+            detail::oriented_minimizer{last.first.cached_hash, !last_reverse};
+
+          if (reverse_start < *start) {
+            start = reverse_start;
+            chain = walk_unitig(lookup, *start);
+          }
+
+          for (auto const& [walked_node, walked_reverse] : chain) {
+            walked.insert({{walked_node.first.cached_hash, false}, true});
+          }
+
+          auto const size = chain.size();
+          if (simplified.insert({*start, ::std::move(chain)})) {
+            recomputed += size;
+          }
+        }
+      });
+
+    stats.recomputed = recomputed;
+
+    return simplified;
+  }
+
+}
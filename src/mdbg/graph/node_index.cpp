@@ -0,0 +1,40 @@
+#include <mdbg/graph/node_index.hpp>
+
+#include <tbb/parallel_for.h>
+
+#include <memory>
+
+namespace mdbg::graph {
+
+  node_index::node_index(de_bruijn_graph_t const& dbg) noexcept {
+    // keep the load factor at or below 1/2 so probes stay short
+    ::std::uint64_t capacity = 16;
+    while (capacity < 2 * dbg.size()) {
+      capacity <<= 1;
+    }
+
+    // slots are trivially destructible, only the memory is released
+    slots = {slot_allocator{}.allocate(capacity), release_slots{capacity}};
+    ::std::uninitialized_value_construct_n(slots.get(), capacity);
+    mask = capacity - 1;
+
+    ::tbb::parallel_for(
+      dbg.range(),
+      [this](de_bruijn_graph_t::const_range_type const& range) {
+        for (auto const& node : range) {
+          auto const hash = node.first.cached_hash.collapse();
+
+          for (auto i = hash & mask;; i = (i + 1) & mask) {
+            value_type const* expected = nullptr;
+            // hashes are published by the end of parallel_for
+            if (slots[i].node.compare_exchange_strong(
+                  expected, &node, ::std::memory_order_relaxed)) {
+              slots[i].hash = hash;
+              break;
+            }
+          }
+        }
+      });
+  }
+
+}
@@ -0,0 +1,655 @@
+#include <mdbg/graph/partition.hpp>
+#include <mdbg/metrics.hpp>
+#include <mdbg/util.hpp>
+
+#include <tsl/robin_map.h>
+#include <tsl/robin_set.h>
+
+#include <tbb/blocked_range.h>
+#include <tbb/parallel_for.h>
+
+#include <algorithm>
+#include <deque>
+#include <optional>
+#include <string>
+#include <utility>
+
+namespace mdbg::graph {
+
+  partitioned_windows::partitioned_windows(::std::filesystem::path directory) noexcept
+    : directory(::std::move(directory))
+    , locks(new ::std::mutex[buckets])
+  {
+    ::std::error_code error;
+    ::std::filesystem::create_directories(this->directory, error);
+    if (error) {
+      ::mdbg::terminate("unable to create partition directory ", this->directory);
+    }
+
+    for (::std::size_t i = 0; i < buckets; ++i) {
+      auto const path = this->directory / ("bucket_" + ::std::to_string(i));
+      files[i] = ::std::fopen(path.c_str(), "w+b");
+      if (files[i] == nullptr) {
+        ::mdbg::terminate("unable to create partition bucket ", path);
+      }
+    }
+  }
+
+  partitioned_windows::~partitioned_windows() {
+    for (::std::size_t i = 0; i < buckets; ++i) {
+      ::std::fclose(files[i]);
+      ::std::filesystem::remove(directory / ("bucket_" + ::std::to_string(i)));
+    }
+    ::std::error_code ignored;
+    ::std::filesystem::remove(directory, ignored);
+  }
+
+  void partitioned_windows::write(
+    ::std::size_t const bucket,
+    detail::window_record const* records,
+    ::std::size_t const count
+  ) noexcept {
+    ::std::scoped_lock<::std::mutex> scoped{locks[bucket]};
+
+    if (::std::fwrite(records, sizeof(*records), count, files[bucket]) != count) {
+      ::mdbg::terminate("unable to write partition bucket ", bucket);
+    }
+  }
+
+  ::std::size_t partitioned_windows::size(::std::size_t const bucket) noexcept {
+    ::std::fflush(files[bucket]);
+    ::std::fseek(files[bucket], 0, SEEK_END);
+    return static_cast<::std::size_t>(::std::ftell(files[bucket]))
+      / sizeof(detail::window_record);
+  }
+
+  ::std::vector<detail::window_record> partitioned_windows::read(
+    ::std::size_t const bucket
+  ) noexcept {
+    ::std::vector<detail::window_record> rv(size(bucket));
+
+    ::std::rewind(files[bucket]);
+    if (::std::fread(rv.data(), sizeof(rv[0]), rv.size(), files[bucket]) != rv.size()) {
+      ::mdbg::terminate("unable to read partition bucket ", bucket);
+    }
+
+    return rv;
+  }
+
+  void construct(
+    partitioned_windows& windows,
+    partition_batch& batch,
+    read_minimizers_t const& read_minimizers,
+    command_line_options const& opts
+  ) noexcept {
+    detail::compact_minimizer prev, current;
+    bool has_prev = false, has_current = false;
+
+    auto const emit = [&](detail::compact_minimizer const* next) {
+      detail::window_record record{
+        current.cached_hash, {}, {},
+        static_cast<::std::uint32_t>(current.minimizer->read),
+        static_cast<::std::uint32_t>(current.minimizer - read_minimizers.begin()),
+        current.reverse ? detail::window_record::reverse : ::std::uint8_t{0}
+      };
+
+      if (has_prev) {
+        record.prev = prev.cached_hash;
+        record.flags |= detail::window_record::has_prev;
+        if (prev.reverse) {
+          record.flags |= detail::window_record::prev_reverse;
+        }
+      }
+
+      if (next != nullptr) {
+        record.next = next->cached_hash;
+        record.flags |= detail::window_record::has_next;
+        if (next->reverse) {
+          record.flags |= detail::window_record::next_reverse;
+        }
+      }
+
+      auto const bucket = partitioned_windows::bucket_of(current.cached_hash);
+      auto& records = batch.records[bucket];
+
+      records.push_back(record);
+      if (records.size() >= partition_batch::capacity) {
+        windows.write(bucket, records.data(), records.size());
+        records.clear();
+      }
+    };
+
+    // a window's record needs both of its neighbours, so records
+    // trail the walk by one window
+    for_each_window(read_minimizers, opts, [&](detail::compact_minimizer const& window) {
+      if (has_current) {
+        emit(&window);
+        prev = current;
+        has_prev = true;
+      }
+
+      current = window;
+      has_current = true;
+    });
+
+    if (has_current) {
+      emit(nullptr);
+    }
+  }
+
+  void flush(partitioned_windows& windows, partition_batch& batch) noexcept {
+    for (::std::size_t bucket = 0; bucket < partitioned_windows::buckets; ++bucket) {
+      auto& records = batch.records[bucket];
+      if (!records.empty()) {
+        windows.write(bucket, records.data(), records.size());
+        records.clear();
+      }
+    }
+  }
+
+  namespace {
+
+    // rough upper bound on the memory taken by the graph per window record,
+    // assuming every record adds a node
+    ::std::size_t constexpr bytes_per_record = 192;
+
+    struct collapsed_hash {
+      ::std::size_t operator()(::mdbg::node_hash const& h) const noexcept {
+        return h.collapse();
+      }
+    };
+
+    using hash_set_t = ::tsl::robin_set<::mdbg::node_hash, collapsed_hash>;
+
+    // hashes of nodes seen fewer than min_abundance times, filed under
+    // the buckets of their neighbours
+    //
+    // all windows of a node land in the same bucket, so its abundance is
+    // known once the bucket is counted; edges leading out of a partition
+    // are only dropped through the notes filed under its own buckets,
+    // which keeps what a partition needs proportional to its size
+    class weak_neighbours {
+      ::std::size_t static constexpr capacity = 1 << 8;
+
+      ::std::filesystem::path directory;
+      ::std::array<FILE*, partitioned_windows::buckets> files;
+      ::std::array<::std::vector<::mdbg::node_hash>, partitioned_windows::buckets> pending;
+
+      ::std::filesystem::path path(::std::size_t const bucket) const noexcept {
+        return directory / ("weak_" + ::std::to_string(bucket));
+      }
+
+      void write(::std::size_t const bucket) noexcept {
+        auto& hashes = pending[bucket];
+        if (::std::fwrite(hashes.data(), sizeof(hashes[0]), hashes.size(), files[bucket])
+              != hashes.size()) {
+          ::mdbg::terminate("unable to write partition notes ", path(bucket));
+        }
+        hashes.clear();
+      }
+
+     public:
+      explicit weak_neighbours(::std::filesystem::path directory) noexcept
+        : directory(::std::move(directory))
+      {
+        for (::std::size_t i = 0; i < partitioned_windows::buckets; ++i) {
+          files[i] = ::std::fopen(path(i).c_str(), "w+b");
+          if (files[i] == nullptr) {
+            ::mdbg::terminate("unable to create partition notes ", path(i));
+          }
+        }
+      }
+
+      ~weak_neighbours() {
+        for (::std::size_t i = 0; i < partitioned_windows::buckets; ++i) {
+          ::std::fclose(files[i]);
+          ::std::filesystem::remove(path(i));
+        }
+      }
+
+      weak_neighbours(weak_neighbours const&) = delete;
+      weak_neighbours& operator=(weak_neighbours const&) = delete;
+
+      // counts the bucket, files every weak node under its neighbours,
+      // returns the number of weak nodes
+      ::std::size_t count(
+        ::std::vector<detail::window_record> const& records,
+        ::std::size_t const min_abundance
+      ) noexcept {
+        ::tsl::robin_map<::mdbg::node_hash, ::std::size_t, collapsed_hash> counts;
+        for (auto const& record : records) {
+          ++counts[record.hash];
+        }
+
+        ::std::size_t rv = 0;
+        for (auto const& [hash, seen] : counts) {
+          rv += seen < min_abundance;
+        }
+
+        auto const file = [this](::mdbg::node_hash const& neighbour, auto const& hash) {
+          auto const bucket = partitioned_windows::bucket_of(neighbour);
+          pending[bucket].push_back(hash);
+          if (pending[bucket].size() >= capacity) {
+            write(bucket);
+          }
+        };
+
+        for (auto const& record : records) {
+          if (counts[record.hash] >= min_abundance) {
+            continue;
+          }
+          if (record.flags & detail::window_record::has_prev) {
+            file(record.prev, record.hash);
+          }
+          if (record.flags & detail::window_record::has_next) {
+            file(record.next, record.hash);
+          }
+        }
+
+        return rv;
+      }
+
+      // weak nodes next to the nodes of the given buckets, all counting
+      // has to be done
+      hash_set_t read(::std::size_t const first, ::std::size_t const last) noexcept {
+        hash_set_t rv;
+        for (auto bucket = first; bucket < last; ++bucket) {
+          write(bucket);
+          ::std::vector<::mdbg::node_hash>{}.swap(pending[bucket]);
+
+          ::std::fflush(files[bucket]);
+          ::std::fseek(files[bucket], 0, SEEK_END);
+          ::std::vector<::mdbg::node_hash> hashes(
+            static_cast<::std::size_t>(::std::ftell(files[bucket])) / sizeof(::mdbg::node_hash));
+
+          ::std::rewind(files[bucket]);
+          if (::std::fread(hashes.data(), sizeof(hashes[0]), hashes.size(), files[bucket])
+                != hashes.size()) {
+            ::mdbg::terminate("unable to read partition notes ", path(bucket));
+          }
+          rv.insert(hashes.begin(), hashes.end());
+        }
+        return rv;
+      }
+    };
+
+    void insert_records(
+      de_bruijn_graph_t& graph,
+      ::std::vector<detail::window_record> const& records,
+      read_minimizers_index_t const& index,
+      hash_set_t const& weak
+    ) noexcept {
+      auto const keep = [&weak](::mdbg::node_hash const& hash) {
+        return weak.count(hash) == 0;
+      };
+
+      ::tbb::parallel_for(
+        ::tbb::blocked_range<::std::size_t>{0, records.size()},
+        [&](::tbb::blocked_range<::std::size_t> const& range) {
+          de_bruijn_graph_t::accessor accessor;
+
+          for (auto i = range.begin(); i != range.end(); ++i) {
+            auto const& record = records[i];
+            if (!keep(record.hash)) {
+              continue;
+            }
+
+            auto const reverse = (record.flags & detail::window_record::reverse) != 0;
+            auto const window = detail::compact_minimizer{
+              index(record.read).begin() + record.index, record.hash, reverse};
+
+            graph.insert(accessor, {window, {}});
+            auto& node = accessor->second;
+            node.increment();
+
+            if ((record.flags & detail::window_record::has_next) && keep(record.next)) {
+              node.edges.insert({
+                reverse,
+                {record.next, (record.flags & detail::window_record::next_reverse) != 0}
+              });
+            }
+
+            // same edge as seen from the opposite strand
+            if ((record.flags & detail::window_record::has_prev) && keep(record.prev)) {
+              node.edges.insert({
+                !reverse,
+                {record.prev, (record.flags & detail::window_record::prev_reverse) == 0}
+              });
+            }
+          }
+        });
+    }
+
+    // node of a fragment, only the two end nodes of a fragment keep
+    // their edges, which is all stitching and the links between unitigs
+    // need
+    struct fragment_node {
+      detail::compact_minimizer minimizer;
+      ::std::uint16_t count;
+      bool reverse;
+    };
+
+    // edges of an end node of a fragment, read like a dbg_node's
+    struct end_edges {
+      ::std::deque<detail::dbg_edge> const& edges;
+      ::std::size_t begin;
+      ::std::size_t end;
+
+      template<typename F>
+      void for_each_out_edge(bool const reverse, F&& f) const noexcept {
+        for (auto i = begin; i < end; ++i) {
+          if (edges[i].from_reverse == reverse) {
+            f(edges[i].to);
+          }
+        }
+      }
+
+      ::std::size_t out_degree(bool const reverse) const noexcept {
+        ::std::size_t rv = 0;
+        for_each_out_edge(reverse, [&rv](auto const&) { ++rv; });
+        return rv;
+      }
+
+      ::std::size_t in_degree(bool const reverse) const noexcept {
+        return out_degree(!reverse);
+      }
+    };
+
+    // unitigs of the finished partitions, stored back to back so that a
+    // fragment costs no allocation of its own
+    class fragment_store {
+      ::std::deque<fragment_node> nodes;
+      ::std::deque<detail::dbg_edge> edges;
+
+      // where the nodes of each fragment end, and the edges of its first
+      // and of its last node
+      ::std::vector<::std::size_t> node_ends;
+      ::std::vector<::std::size_t> edge_ends;
+
+     public:
+      void add(simplified_graph_t::mapped_type const& chain) noexcept {
+        for (auto const& [node, reverse] : chain) {
+          nodes.push_back({node.first, node.second.count, reverse});
+        }
+        node_ends.push_back(nodes.size());
+
+        auto const& first = chain.front().node.second.edges;
+        edges.insert(edges.end(), first.begin(), first.end());
+        edge_ends.push_back(edges.size());
+
+        // a single node is its own last node
+        if (chain.size() > 1) {
+          auto const& last = chain.back().node.second.edges;
+          edges.insert(edges.end(), last.begin(), last.end());
+        }
+        edge_ends.push_back(edges.size());
+      }
+
+      ::std::size_t size() const noexcept {
+        return node_ends.size();
+      }
+
+      ::std::size_t length(::std::size_t const id) const noexcept {
+        return node_ends[id] - (id == 0 ? 0 : node_ends[id - 1]);
+      }
+
+      fragment_node const& node(::std::size_t const id, ::std::size_t const i) const noexcept {
+        return nodes[(id == 0 ? 0 : node_ends[id - 1]) + i];
+      }
+
+      end_edges front_edges(::std::size_t const id) const noexcept {
+        return {edges, id == 0 ? 0 : edge_ends[2 * id - 1], edge_ends[2 * id]};
+      }
+
+      end_edges back_edges(::std::size_t const id) const noexcept {
+        return length(id) == 1
+          ? front_edges(id)
+          : end_edges{edges, edge_ends[2 * id], edge_ends[2 * id + 1]};
+      }
+    };
+
+    // a fragment read in one of its two orientations
+    struct oriented_fragment {
+      ::std::size_t id;
+      bool flipped;
+    };
+
+    class stitcher {
+      fragment_store const& fragments;
+      ::std::vector<::std::size_t> const& partition_of_bucket;
+
+      // oriented first node -> fragment starting with it
+      oriented_minimizer_map_t<oriented_fragment> starts;
+
+      detail::oriented_minimizer first(oriented_fragment const& f) const noexcept {
+        if (f.flipped) {
+          auto const& back = fragments.node(f.id, fragments.length(f.id) - 1);
+          return {back.minimizer.cached_hash, !back.reverse};
+        }
+        auto const& front = fragments.node(f.id, 0);
+        return {front.minimizer.cached_hash, front.reverse};
+      }
+
+      ::std::size_t partition_of(::mdbg::node_hash const& hash) const noexcept {
+        return partition_of_bucket[partitioned_windows::bucket_of(hash)];
+      }
+
+     public:
+      stitcher(
+        fragment_store const& fragments,
+        ::std::vector<::std::size_t> const& partition_of_bucket
+      ) noexcept
+        : fragments(fragments)
+        , partition_of_bucket(partition_of_bucket)
+      {
+        starts.reserve(2 * fragments.size());
+        for (::std::size_t id = 0; id < fragments.size(); ++id) {
+          starts.insert({first({id, false}), {id, false}});
+          starts.insert({first({id, true}), {id, true}});
+        }
+      }
+
+      // fragment continuing the unitig past the end of 'f', if the walk
+      // through the whole graph would not have stopped there
+      ::std::optional<oriented_fragment> next(oriented_fragment const& f) const noexcept {
+        auto const& last = f.flipped
+          ? fragments.node(f.id, 0)
+          : fragments.node(f.id, fragments.length(f.id) - 1);
+        auto const edges = f.flipped
+          ? fragments.front_edges(f.id)
+          : fragments.back_edges(f.id);
+        auto const reverse = last.reverse != f.flipped;
+
+        if (edges.out_degree(reverse) != 1) {
+          return ::std::nullopt;
+        }
+
+        detail::oriented_minimizer target;
+        edges.for_each_out_edge(reverse, [&target](auto const& to) {
+          target = to;
+        });
+
+        // within a partition the fragment ended for the same
+        // reasons a unitig would
+        if (partition_of(target.cached_hash) == partition_of(last.minimizer.cached_hash)) {
+          return ::std::nullopt;
+        }
+
+        auto const found = starts.find(target);
+        if (found == starts.end()) {
+          return ::std::nullopt;
+        }
+
+        auto const target_edges = found->second.flipped
+          ? fragments.back_edges(found->second.id)
+          : fragments.front_edges(found->second.id);
+        if (target_edges.in_degree(target.reverse) != 1) {
+          return ::std::nullopt;
+        }
+
+        return found->second;
+      }
+
+      // nodes joined inside the unitig keep their edges as well, they
+      // are few and harmless
+      void append(
+        simplified_graph_t::mapped_type& unitig,
+        oriented_fragment const& f
+      ) const noexcept {
+        auto const length = fragments.length(f.id);
+
+        for (::std::size_t i = 0; i < length; ++i) {
+          auto const j = f.flipped ? length - 1 - i : i;
+          auto const& node = fragments.node(f.id, j);
+
+          detail::dbg_node rv;
+          rv.count = node.count;
+          if (j == 0 || j + 1 == length) {
+            auto const edges = j == 0 ? fragments.front_edges(f.id) : fragments.back_edges(f.id);
+            for (auto e = edges.begin; e < edges.end; ++e) {
+              rv.edges.insert(edges.edges[e]);
+            }
+          }
+
+          unitig.push_back({{node.minimizer, ::std::move(rv)}, node.reverse != f.flipped});
+        }
+      }
+
+      detail::oriented_minimizer start_of(oriented_fragment const& f) const noexcept {
+        return first(f);
+      }
+    };
+
+    simplified_graph_t stitch(
+      fragment_store const& fragments,
+      ::std::vector<::std::size_t> const& partition_of_bucket
+    ) noexcept {
+      stitcher const joints{fragments, partition_of_bucket};
+
+      // oriented fragments some other fragment continues into
+      ::std::vector<bool> continued(2 * fragments.size(), false);
+      for (::std::size_t id = 0; id < fragments.size(); ++id) {
+        for (bool const flipped : {false, true}) {
+          if (auto const next = joints.next({id, flipped})) {
+            continued[2 * next->id + next->flipped] = true;
+          }
+        }
+      }
+
+      simplified_graph_t rv;
+      ::std::vector<bool> visited(fragments.size(), false);
+
+      auto const walk = [&](oriented_fragment f) {
+        auto const start = joints.start_of(f);
+        simplified_graph_t::mapped_type unitig;
+
+        for (;;) {
+          visited[f.id] = true;
+          joints.append(unitig, f);
+
+          auto const next = joints.next(f);
+          if (!next || visited[next->id]) {
+            break;
+          }
+          f = *next;
+        }
+
+        rv.insert({start, ::std::move(unitig)});
+      };
+
+      // every unitig is walked once, from whichever end comes first
+      for (::std::size_t id = 0; id < fragments.size(); ++id) {
+        for (bool const flipped : {false, true}) {
+          if (!visited[id] && !continued[2 * id + flipped]) {
+            walk({id, flipped});
+          }
+        }
+      }
+
+      // cycles running through several partitions have no start
+      for (::std::size_t id = 0; id < fragments.size(); ++id) {
+        if (!visited[id]) {
+          walk({id, false});
+        }
+      }
+
+      return rv;
+    }
+
+  }
+
+  simplified_graph_t assemble_partitioned(
+    partitioned_windows& windows,
+    read_minimizers_index_t const& index,
+    ::std::size_t const max_memory,
+    command_line_options const& opts,
+    partition_stats& stats
+  ) noexcept {
+    stats = {};
+
+    ::std::optional<weak_neighbours> weak;
+    if (opts.min_abundance > 1) {
+      weak.emplace(windows.path());
+      for (::std::size_t bucket = 0; bucket < partitioned_windows::buckets; ++bucket) {
+        stats.removed += weak->count(windows.read(bucket), opts.min_abundance);
+      }
+    }
+
+    ::std::array<::std::size_t, partitioned_windows::buckets> sizes;
+    ::std::size_t largest = 0;
+    for (::std::size_t bucket = 0; bucket < partitioned_windows::buckets; ++bucket) {
+      sizes[bucket] = windows.size(bucket);
+      largest = ::std::max(largest, sizes[bucket]);
+    }
+
+    ::std::vector<::std::size_t> partition_of_bucket(partitioned_windows::buckets);
+    fragment_store fragments;
+
+    for (::std::size_t bucket = 0; bucket < partitioned_windows::buckets;) {
+      // whatever the process holds by now, reads and earlier
+      // fragments included, is taken out of the budget
+      auto const held = ::mdbg::metrics::usage::now().rss
+        + largest * sizeof(detail::window_record);
+      auto const budget = max_memory > held ? max_memory - held : 0;
+
+      // a partition takes at least one bucket, whatever the budget
+      if (sizes[bucket] * bytes_per_record > budget) {
+        ++stats.oversized;
+      }
+
+      auto const first = bucket;
+      auto last = bucket + 1;
+      ::std::size_t records = sizes[bucket];
+      while (last < partitioned_windows::buckets
+          && (records + sizes[last]) * bytes_per_record <= budget) {
+        records += sizes[last++];
+      }
+
+      auto const weak_hashes = weak ? weak->read(first, last) : hash_set_t{};
+
+      de_bruijn_graph_t graph;
+      for (; bucket < last; ++bucket) {
+        partition_of_bucket[bucket] = stats.partitions;
+        insert_records(graph, windows.read(bucket), index, weak_hashes);
+      }
+
+      // weak nodes without notes under the partition's buckets made it
+      // in, they were already counted with their bucket
+      if (opts.min_abundance > 1) {
+        remove_low_abundance(graph, opts.min_abundance);
+      }
+
+      stats.nodes += graph.size();
+      ++stats.partitions;
+
+      auto const simplified = simplify_partition(graph);
+      for (auto const& [start, chain] : simplified) {
+        fragments.add(chain);
+      }
+    }
+
+    stats.fragments = fragments.size();
+    return stitch(fragments, partition_of_bucket);
+  }
+
+}
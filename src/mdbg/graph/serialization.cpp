@@ -0,0 +1,249 @@
+#include <mdbg/graph/serialization.hpp>
+#include <mdbg/util.hpp>
+
+#include <cstdio>
+#include <cstring>
+#include <memory>
+
+namespace mdbg::graph {
+
+  namespace {
+
+    char constexpr magic[8] = {'M', 'D', 'B', 'G', 'G', 'R', 'P', 'H'};
+    char constexpr unitigs_magic[8] = {'M', 'D', 'B', 'G', 'U', 'N', 'I', 'T'};
+    ::std::uint32_t constexpr version = 6;
+    ::std::uint32_t constexpr hash_bits = sizeof(::mdbg::node_hash) * 8;
+
+    ::std::uint8_t constexpr node_reverse = 1 << 0;
+    ::std::uint8_t constexpr node_boundary = 1 << 1;
+
+    ::std::uint8_t constexpr edge_from_reverse = 1 << 0;
+    ::std::uint8_t constexpr edge_to_reverse = 1 << 1;
+
+    using file_ptr = ::std::unique_ptr<FILE, int(*)(FILE*)>;
+
+    file_ptr open(::std::string const& path, char const* mode) noexcept {
+      file_ptr rv{::std::fopen(path.c_str(), mode), &::std::fclose};
+      if (!rv) {
+        ::mdbg::terminate("unable to open graph file ", path);
+      }
+      // nodes are small, let stdio gather them into large writes
+      ::std::setvbuf(rv.get(), nullptr, _IOFBF, 1 << 20);
+      return rv;
+    }
+
+    template<typename T>
+    void write(FILE* out, T const& value, ::std::string const& path) noexcept {
+      if (::std::fwrite(&value, sizeof(T), 1, out) != 1) {
+        ::mdbg::terminate("unable to write graph file ", path);
+      }
+    }
+
+    template<typename T>
+    T read(FILE* in, ::std::string const& path) noexcept {
+      T rv;
+      if (::std::fread(&rv, sizeof(T), 1, in) != 1) {
+        ::mdbg::terminate("truncated graph file ", path);
+      }
+      return rv;
+    }
+
+    void write_magic(FILE* out, char const* expected, ::std::string const& path) noexcept {
+      if (::std::fwrite(expected, 1, sizeof(magic), out) != sizeof(magic)) {
+        ::mdbg::terminate("unable to write graph file ", path);
+      }
+      write(out, version, path);
+      write(out, hash_bits, path);
+    }
+
+    void read_magic(FILE* in, char const* expected, ::std::string const& path) noexcept {
+      char file_magic[sizeof(magic)];
+      if (::std::fread(file_magic, 1, sizeof(magic), in) != sizeof(magic)
+          || ::std::memcmp(file_magic, expected, sizeof(magic)) != 0) {
+        ::mdbg::terminate(path, " is not a graph file");
+      }
+
+      if (read<::std::uint32_t>(in, path) != version) {
+        ::mdbg::terminate(path, " was written by an incompatible version");
+      }
+
+      if (auto const bits = read<::std::uint32_t>(in, path); bits != hash_bits) {
+        ::mdbg::terminate(path, " was written by a build with ", bits, " bit hashes");
+      }
+    }
+
+    graph_header read_header(FILE* in, ::std::string const& path) noexcept {
+      read_magic(in, magic, path);
+      return read<graph_header>(in, path);
+    }
+
+    // parameters the unitigs depend on
+    struct unitigs_header {
+      ::std::uint64_t k;
+      ::std::uint64_t l;
+      double d;
+      ::std::uint64_t min_abundance;
+      ::std::uint64_t unitigs;
+    };
+
+  }
+
+  ::std::string partition_path(
+    ::std::string const& output_prefix,
+    command_line_options const& opts
+  ) noexcept {
+    return output_prefix + "." + ::std::to_string(opts.partition)
+      + "-of-" + ::std::to_string(opts.partitions) + ".partition";
+  }
+
+  void save_graph(
+    ::std::string const& path,
+    de_bruijn_graph_t const& dbg,
+    ::std::size_t const reads,
+    command_line_options const& opts
+  ) noexcept {
+    auto const out = open(path, "wb");
+    auto const window = opts.k - 1;
+
+    write_magic(out.get(), magic, path);
+    write(out.get(), graph_header{
+      opts.k, opts.l, opts.d, static_cast<::std::uint64_t>(opts.scheme),
+      opts.syncmer_s, opts.max_gap, opts.hpc, opts.partition, opts.partitions,
+      opts.sample, reads, dbg.size()}, path);
+
+    for (auto const& [minimizer, node] : dbg) {
+      ::std::uint8_t flags = minimizer.reverse ? node_reverse : 0;
+      for (auto const& edge : node.edges) {
+        if (partition_of(edge.to.cached_hash, opts.partitions) != opts.partition) {
+          flags |= node_boundary;
+        }
+      }
+
+      write(out.get(), minimizer.cached_hash, path);
+      write(out.get(), flags, path);
+      write(out.get(), node.count, path);
+      write(out.get(), static_cast<::std::uint32_t>(node.edges.size()), path);
+
+      for (auto const& edge : node.edges) {
+        write(out.get(), edge.to.cached_hash, path);
+        write(out.get(), static_cast<::std::uint8_t>(
+          (edge.from_reverse ? edge_from_reverse : 0)
+            | (edge.to.reverse ? edge_to_reverse : 0)), path);
+      }
+
+      for (::std::size_t i = 0; i < window; ++i) {
+        write(out.get(), minimizer.minimizer[static_cast<::std::ptrdiff_t>(i)], path);
+      }
+    }
+
+    if (::std::fflush(out.get()) != 0) {
+      ::mdbg::terminate("unable to write graph file ", path);
+    }
+  }
+
+  graph_header read_header(::std::string const& path) noexcept {
+    auto const in = open(path, "rb");
+    return read_header(in.get(), path);
+  }
+
+  graph_header load_graph(
+    ::std::string const& path,
+    de_bruijn_graph_t& dbg,
+    ::std::deque<read_minimizers_t>& windows,
+    ::std::vector<detail::compact_minimizer>& boundary
+  ) noexcept {
+    auto const in = open(path, "rb");
+    auto const header = read_header(in.get(), path);
+    auto const window = header.k - 1;
+
+    // sized up front, nodes point into it
+    auto& minimizers = windows.emplace_back(header.nodes * window);
+
+    de_bruijn_graph_t::accessor accessor;
+
+    for (::std::size_t i = 0; i < header.nodes; ++i) {
+      auto const hash = read<::mdbg::node_hash>(in.get(), path);
+      auto const flags = read<::std::uint8_t>(in.get(), path);
+
+      detail::dbg_node node;
+      node.count = read<decltype(node.count)>(in.get(), path);
+
+      auto const edges = read<::std::uint32_t>(in.get(), path);
+      node.edges.reserve(edges);
+      for (::std::uint32_t j = 0; j < edges; ++j) {
+        auto const to = read<::mdbg::node_hash>(in.get(), path);
+        auto const edge_flags = read<::std::uint8_t>(in.get(), path);
+        node.edges.insert({
+          (edge_flags & edge_from_reverse) != 0,
+          {to, (edge_flags & edge_to_reverse) != 0}
+        });
+      }
+
+      auto const begin = minimizers.begin() + static_cast<::std::ptrdiff_t>(i * window);
+      for (::std::size_t j = 0; j < window; ++j) {
+        begin[static_cast<::std::ptrdiff_t>(j)] = read<detected_minimizer>(in.get(), path);
+      }
+
+      auto const key = detail::compact_minimizer{begin, hash, (flags & node_reverse) != 0};
+      dbg.insert(accessor, {key, {}});
+      accessor->second.merge(node);
+
+      if (flags & node_boundary) {
+        boundary.push_back(key);
+      }
+    }
+
+    return header;
+  }
+
+  void save_unitigs(
+    ::std::string const& path,
+    simplified_graph_t const& simplified,
+    command_line_options const& opts
+  ) noexcept {
+    auto const out = open(path, "wb");
+
+    write_magic(out.get(), unitigs_magic, path);
+    write(out.get(), unitigs_header{
+      opts.k, opts.l, opts.d, opts.min_abundance, simplified.size()}, path);
+
+    for (auto const& [start, unitig_nodes] : simplified) {
+      write(out.get(), static_cast<::std::uint32_t>(unitig_nodes.size()), path);
+      for (auto const& [node, reverse] : unitig_nodes) {
+        write(out.get(), node.first.cached_hash, path);
+        write(out.get(), static_cast<::std::uint8_t>(reverse), path);
+      }
+    }
+
+    if (::std::fflush(out.get()) != 0) {
+      ::mdbg::terminate("unable to write graph file ", path);
+    }
+  }
+
+  saved_unitigs_t load_unitigs(
+    ::std::string const& path,
+    command_line_options const& opts
+  ) noexcept {
+    auto const in = open(path, "rb");
+    read_magic(in.get(), unitigs_magic, path);
+
+    auto const header = read<unitigs_header>(in.get(), path);
+    if (header.k != opts.k || header.l != opts.l || header.d != opts.d
+        || header.min_abundance != opts.min_abundance) {
+      ::mdbg::terminate(path, " was built with different -k, -l, -d or --min-abundance");
+    }
+
+    saved_unitigs_t rv(header.unitigs);
+
+    for (auto& unitig_nodes : rv) {
+      unitig_nodes.resize(read<::std::uint32_t>(in.get(), path));
+      for (auto& node : unitig_nodes) {
+        node.cached_hash = read<::mdbg::node_hash>(in.get(), path);
+        node.reverse = read<::std::uint8_t>(in.get(), path) != 0;
+      }
+    }
+
+    return rv;
+  }
+
+}
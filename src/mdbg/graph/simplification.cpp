@@ -1,103 +1,417 @@
+#include <algorithm>
+#include <atomic>
 #include <cstdio>
 #include <mutex>
+#include <tuple>
 
+#include <mdbg/counters.hpp>
+#include <mdbg/trace.hpp>
 #include <mdbg/graph/simplification.hpp>
 #include <mdbg/graph/construction.hpp>
+#include <mdbg/graph/node_index.hpp>
 
+#include <tbb/concurrent_vector.h>
+#include <tbb/parallel_for.h>
+#include <tbb/parallel_for_each.h>
 #include <tbb/task_group.h>
 
 namespace mdbg::graph {
 
+  using visited_set_t = concurrent_oriented_map_t<bool>;
 
   simplified_graph_t::mapped_type unitig(
-    de_bruijn_graph_t const& dbg,
-    detail::compact_minimizer const& starting_minimizer
+    node_index const& index,
+    detail::oriented_minimizer const& starting_minimizer
   ) noexcept {
-    // we lose quite a bit of performance because we are
-    // reading from a non changing concurrent map
-    // tbb::concurrent_hash_map doesn't support
-    // non locking read only access when you can guarantee
-    // that the map will not change
-    //
-    // as observed with graph construction we are ~2x
-    // slower on a single thread and we break even with
-    // 2 threads - this is acceptable as we don't expect
-    // to run this with less than 4 threads, and usually
-    // we use at least 32
-
-    de_bruijn_graph_t::const_accessor accessor;
-    dbg.find(accessor, starting_minimizer);
-    auto const* current_node = &(*accessor);
-
-    // accessor.release() does not do much in terms of performance
-    // and even though we know the hash_map is not going to change
-    // better to avoid it because surely UB
-
-
-    simplified_graph_t::mapped_type rv{*current_node};
-    
-    // = \       / =
-    // = = ===== = =
-    // = /       \ =
-    //   X       X
-    while (current_node->second.out_edges.size() == 1) {
-      dbg.find(accessor, *current_node->second.out_edges.begin());
-      current_node = &(*accessor);
-      
-      if (current_node->second.fan_in) {
-        break;
-      }
-
-      rv.push_back(*current_node);
-    }
-
-    return rv;
+    // tbb::concurrent_hash_map doesn't support non locking read only
+    // access even when the map is guaranteed not to change, so the walk
+    // goes through a flat index built over the finished graph instead
+    return walk_unitig(
+      [&index](auto const& hash) { return index.find(hash); },
+      starting_minimizer);
   }
 
   void unitig_task(
     simplified_graph_t& simplified,
-    detail::compact_minimizer const minimizer,
-    de_bruijn_graph_t const& dbg,
+    visited_set_t& visited,
+    detail::oriented_minimizer const minimizer,
+    node_index const& index,
     ::std::mutex& to_process_mutex,
     ::tbb::task_group& to_process
   ) noexcept {
-    if (simplified.count(minimizer)) {
+    if (!visited.insert({minimizer, true})) {
       return;
     }
 
-    auto const& chain = unitig(dbg, minimizer);
-    for (auto const& out_edge : chain.back().second.out_edges) {
-      // checking if out_edge is in simplified here does not yield any performance
+    ::mdbg::trace::scope const traced{"unitig_task"};
+
+    auto chain = unitig(index, minimizer);
+    auto const& [last, last_reverse] = chain.back();
+
+    last.second.for_each_out_edge(last_reverse, [&](auto const& out_edge) {
+      if (index.find(out_edge.cached_hash) == nullptr) {
+        return;
+      }
+
       to_process_mutex.lock();
       to_process.run([&, minimizer = out_edge]{
-        unitig_task(simplified, minimizer, dbg, to_process_mutex, to_process);
+        unitig_task(
+          simplified, visited, minimizer, index, to_process_mutex, to_process);
       });
       to_process_mutex.unlock();
+    });
+
+    // the same unitig is also walked from its other end on the opposite
+    // strand, keep whichever of the two starts with the smaller node
+    auto const reverse_start = 
+      detail::oriented_minimizer{last.first.cached_hash, !last_reverse};
+
+    if (!(reverse_start < minimizer)) {
+      ::mdbg::counters::record(
+        ::mdbg::counters::histogram::unitig_length, chain.size());
+      simplified.insert({minimizer, ::std::move(chain)});
+    } else {
+      ::mdbg::counters::add(::mdbg::counters::counter::duplicate_unitig);
+      ::mdbg::counters::add(
+        ::mdbg::counters::counter::duplicate_unitig_nodes, chain.size());
     }
+  }
+
+  void remove_nodes(
+    de_bruijn_graph_t& dbg,
+    ::std::vector<detail::compact_minimizer> const& nodes
+  ) noexcept {
+    minimizer_set_t const removed(nodes.begin(), nodes.end());
+
+    // neighbours keep a mirrored copy of every edge, removed neighbours
+    // are skipped since they are erased as a whole afterwards
+    ::tbb::parallel_for_each(
+      nodes.begin(), nodes.end(),
+      [&dbg, &removed](detail::compact_minimizer const& minimizer) {
+        ::std::vector<detail::dbg_edge> edges;
+
+        {
+          de_bruijn_graph_t::const_accessor accessor;
+          if (!dbg.find(accessor, minimizer)) {
+            return;
+          }
+          edges.assign(accessor->second.edges.begin(), accessor->second.edges.end());
+        }
 
-    simplified.insert({minimizer, ::std::move(chain)});
+        de_bruijn_graph_t::accessor accessor;
+
+        for (auto const& edge : edges) {
+          if (removed.count(edge.to.key()) || !dbg.find(accessor, edge.to.key())) {
+            continue;
+          }
+
+          auto& neighbour_edges = accessor->second.edges;
+          for (auto iter = neighbour_edges.begin(); iter != neighbour_edges.end();) {
+            if (iter->to.cached_hash == minimizer.cached_hash) {
+              iter = neighbour_edges.erase(iter);
+            } else {
+              ++iter;
+            }
+          }
+        }
+      });
+
+    ::tbb::parallel_for_each(
+      nodes.begin(), nodes.end(),
+      [&dbg](detail::compact_minimizer const& minimizer) {
+        dbg.erase(minimizer);
+      });
   }
 
-  simplified_graph_t simplify(de_bruijn_graph_t const& dbg) noexcept {
-    if (dbg.empty()) {
-      return simplified_graph_t{};
+  void remove_edge(
+    de_bruijn_graph_t& dbg,
+    detail::oriented_minimizer const& from,
+    detail::oriented_minimizer const& to
+  ) noexcept {
+    de_bruijn_graph_t::accessor accessor;
+
+    if (dbg.find(accessor, from.key())) {
+      accessor->second.edges.erase({from.reverse, to});
     }
 
-    ::std::mutex to_process_mutex;
-    ::tbb::task_group to_process;
+    if (dbg.find(accessor, to.key())) {
+      accessor->second.edges.erase({!to.reverse, from.flip()});
+    }
+  }
+
+  ::std::size_t remove_dangling_edges(
+    de_bruijn_graph_t& dbg,
+    ::std::vector<detail::compact_minimizer> const& nodes
+  ) noexcept {
+    ::std::atomic<::std::size_t> removed = 0;
+
+    ::tbb::parallel_for_each(
+      nodes.begin(), nodes.end(),
+      [&dbg, &removed](detail::compact_minimizer const& minimizer) {
+        ::std::vector<detail::dbg_edge> dangling;
+
+        {
+          de_bruijn_graph_t::const_accessor accessor;
+          if (!dbg.find(accessor, minimizer)) {
+            return;
+          }
+          dangling.assign(accessor->second.edges.begin(), accessor->second.edges.end());
+        }
 
-    simplified_graph_t simplified;
+        // neighbours are looked up without holding the node
+        dangling.erase(
+          ::std::remove_if(dangling.begin(), dangling.end(), [&dbg](auto const& edge) {
+            return dbg.count(edge.to.key()) != 0;
+          }),
+          dangling.end());
 
-    for (auto const& [minimizer_ref, node] : dbg) {
-      if (node.fan_in || !node.last_in.has_value()) {
-        to_process.run([&, minimizer = minimizer_ref]{
-          unitig_task(simplified, minimizer, dbg, to_process_mutex, to_process);
-        });
+        if (dangling.empty()) {
+          return;
+        }
+
+        de_bruijn_graph_t::accessor accessor;
+        if (dbg.find(accessor, minimizer)) {
+          for (auto const& edge : dangling) {
+            accessor->second.edges.erase(edge);
+          }
+        }
+        removed += dangling.size();
+      });
+
+    return removed;
+  }
+
+  ::std::size_t remove_low_abundance(
+    de_bruijn_graph_t& dbg,
+    ::std::size_t const min_abundance
+  ) noexcept {
+    ::tbb::concurrent_vector<detail::compact_minimizer> to_remove;
+
+    ::tbb::parallel_for(
+      dbg.range(),
+      [&to_remove, min_abundance](de_bruijn_graph_t::range_type const& range) {
+        for (auto const& [minimizer, node] : range) {
+          if (node.count < min_abundance) {
+            to_remove.push_back(minimizer);
+          }
+        }
+      });
+
+    remove_nodes(dbg, {to_remove.begin(), to_remove.end()});
+    return to_remove.size();
+  }
+
+  namespace {
+
+    // does the only predecessor of the oriented node lie outside the index
+    bool enters_partition(
+      node_index const& index,
+      detail::dbg_node const& node,
+      bool const reverse
+    ) noexcept {
+      bool rv = false;
+      node.for_each_out_edge(!reverse, [&index, &rv](auto const& to) {
+        rv = index.find(to.cached_hash) == nullptr;
+      });
+      return rv;
+    }
+
+    simplified_graph_t simplify_nodes(
+      de_bruijn_graph_t const& dbg,
+      bool const partition
+    ) noexcept {
+      if (dbg.empty()) {
+        return simplified_graph_t{};
+      }
+
+      ::std::mutex to_process_mutex;
+      ::tbb::task_group to_process;
+
+      simplified_graph_t simplified;
+      visited_set_t visited;
+      node_index const index{dbg};
+
+      for (auto const& [minimizer_ref, node] : dbg) {
+        for (bool const reverse : {false, true}) {
+          auto const start = node.in_degree(reverse) != 1 
+            || (partition && enters_partition(index, node, reverse));
+
+          if (start) {
+            to_process.run([&, minimizer = minimizer_ref, reverse]{
+              unitig_task(
+                simplified, visited, {minimizer.cached_hash, reverse},
+                index, to_process_mutex, to_process);
+            });
+          }
+        }
+      }
+
+      to_process.wait();
+      return simplified;
+    }
+
+  }
+
+  simplified_graph_t simplify(de_bruijn_graph_t const& dbg) noexcept {
+    return simplify_nodes(dbg, false);
+  }
+
+  simplified_graph_t simplify_partition(de_bruijn_graph_t const& dbg) noexcept {
+    return simplify_nodes(dbg, true);
+  }
+
+  namespace {
+
+    char complement(char const base) noexcept {
+      switch (base) {
+        case 'A': case 'a': return 'T';
+        case 'C': case 'c': return 'G';
+        case 'G': case 'g': return 'C';
+        case 'T': case 't': return 'A';
+        default:            return 'N';
+      }
+    }
+
+    void write_bases(
+      ::std::ostream& out,
+      ::std::string_view const read,
+      ::std::size_t const offset,
+      ::std::size_t const len,
+      bool const reverse_complement
+    ) noexcept {
+      if (!reverse_complement) {
+        out.write(read.data() + offset, static_cast<::std::streamsize>(len));
+        return;
       }
+
+      for (auto i = offset + len; i > offset; --i) {
+        out.put(complement(read[i - 1]));
+      }
+    }
+
+  }
+
+  node_span span(
+    unitig_node const& node,
+    bool const first,
+    command_line_options const& opts
+  ) noexcept {
+    auto const window = opts.k - 1;
+    auto const begin = node.node.first.minimizer;
+    // does the stored occurrence run against the traversal
+    auto const flipped = node.reverse != node.node.first.reverse;
+
+    // the first node contributes its whole window, every other node
+    // only the bases between its last two minimizers in traversal order
+    if (first) {
+      return {
+        begin->read,
+        begin->offset, 
+        calculate_length(begin, window),
+        flipped
+      };
+    }
+
+    // between the starts of the first two minimizers when flipped, else
+    // between the ends of the last two
+    if (flipped) {
+      return {
+        begin->read,
+        begin->offset,
+        static_cast<::std::size_t>(begin[1].offset - begin->offset),
+        true
+      };
+    }
+
+    auto const& last = begin[static_cast<::std::ptrdiff_t>(window) - 1];
+    auto const& previous = begin[static_cast<::std::ptrdiff_t>(window) - 2];
+
+    return {
+      begin->read,
+      ::std::size_t{previous.offset} + previous.length,
+      static_cast<::std::size_t>(last.offset + last.length - previous.offset - previous.length),
+      false
+    };
+  }
+
+  ::std::size_t unitig_length(
+    simplified_graph_t::mapped_type const& unitig_nodes,
+    command_line_options const& opts
+  ) noexcept {
+    ::std::size_t total_len = 0;
+    for (::std::size_t i = 0; i < unitig_nodes.size(); ++i) {
+      total_len += span(unitig_nodes[i], i == 0, opts).length;
+    }
+    return total_len;
+  }
+
+  ::std::size_t overlap_length(
+    unitig_node const& tail,
+    bool const reverse,
+    command_line_options const& opts
+  ) noexcept {
+    auto const window = opts.k - 1;
+    auto const begin = tail.node.first.minimizer;
+    auto const flipped = reverse != tail.node.first.reverse;
+    // all minimizers of the window but the first one in traversal order
+    return calculate_length(flipped ? begin : begin + 1, window - 1);
+  }
+
+  segment_index_t index_segments(simplified_graph_t const& graph) noexcept {
+    segment_index_t entries;
+
+    ::std::size_t segment = 0;
+    for (auto const& [starting_minimizer, unitig_nodes] : graph) {
+      auto const& [last, last_reverse] = unitig_nodes.back();
+
+      entries.try_emplace(starting_minimizer, segment, false);
+      entries.try_emplace({last.first.cached_hash, !last_reverse}, segment, true);
+      ++segment;
     }
 
-    to_process.wait();
-    return simplified;
+    return entries;
+  }
+
+  void for_each_link(
+    simplified_graph_t const& graph,
+    segment_index_t const& segments,
+    ::std::function<void(segment_link const&)> const& f
+  ) noexcept {
+    ::std::size_t segment = 0;
+    for (auto const& [starting_minimizer, unitig_nodes] : graph) {
+      auto const links_from = [&](
+        unitig_node const& tail, bool const reverse, bool const segment_reverse
+      ) {
+        tail.node.second.for_each_out_edge(reverse, [&](auto const& out_key) {
+          auto const iter = segments.find(out_key);
+          if (iter == segments.end()) {
+            return;
+          }
+
+          auto const [other, other_reverse] = iter->second;
+
+          // every link is found from both of its ends,
+          // report only one of the two equivalent forms
+          if (::std::make_tuple(other, !other_reverse, segment, !segment_reverse) 
+                < ::std::tie(segment, segment_reverse, other, other_reverse)) {
+            return;
+          }
+
+          f({
+            segment, segment_reverse, other, other_reverse,
+            tail, {tail.node.first.cached_hash, reverse}, out_key
+          });
+        });
+      };
+
+      auto const& back = unitig_nodes.back();
+      auto const& front = unitig_nodes.front();
+
+      links_from(back, back.reverse, false);
+      links_from(front, !front.reverse, true);
+
+      ++segment;
+    }
   }
 
   void write_gfa(
@@ -106,41 +420,46 @@ namespace mdbg::graph {
     sequence_index_t const& index,
     command_line_options const& opts
   ) noexcept {
-    auto get_index = [
-      indexes = minimizer_map_t<::std::size_t>{}, index = 0
-    ](auto&& key) mutable {
-      auto const [iter, is_inserted] = indexes.try_emplace(key, index);
-      index += is_inserted;
-      return iter.value();
-    };
+    auto const segments = index_segments(graph);
 
     out << "H\tVN:Z:1.0" << "\n";
 
-    for (auto const& [starting_minimizer, minimizer_node_pairs] : graph) {
+    // segments are traced in chunks, single ones are too short to see
+    constexpr ::std::size_t trace_chunk = 1024;
+    auto chunk_begin = ::mdbg::trace::is_enabled() ? ::mdbg::trace::now() : 0;
+
+    ::std::size_t segment = 0;
+    for (auto const& [starting_minimizer, unitig_nodes] : graph) {
       if (!out) {
         break;
       }
 
-      out << "S\t" << get_index(starting_minimizer) << "\t";
-
-      ::std::size_t total_len = 0;
-
-      for (auto const& [current_minimizer, node_data] : minimizer_node_pairs) {
+      if (::mdbg::trace::is_enabled() && segment != 0 && segment % trace_chunk == 0) {
+        auto const now = ::mdbg::trace::now();
+        ::mdbg::trace::record("write chunk", chunk_begin, now);
+        chunk_begin = now;
+      }
 
-        auto const begin = current_minimizer.minimizer;
-        auto const len   = 
-          calculate_length(
-            current_minimizer.minimizer,
-            node_data.out_edges.empty() ? opts.k - 1 : 2,
-            opts.l
-          ) + (node_data.out_edges.empty() ? opts.l : 0);
+      out << "S\t" << segment++ << "\t";
 
-        total_len += len;
+      ::std::size_t total_len = 0;
+      // sum of node counts, and the largest one which is a lower bound
+      // on the number of reads passing through the segment
+      ::std::size_t kmer_count = 0;
+      ::std::size_t read_count = 0;
+
+      for (auto const& current : unitig_nodes) {
+        auto const count = current.node.second.count;
+        kmer_count += count;
+        read_count = ::std::max<::std::size_t>(read_count, count);
+
+        auto const bases = span(current, total_len == 0, opts);
+        total_len += bases.length;
         
         if (opts.sequences) {
-          auto const& read = index(begin->read);
-          out.write(read.data() + begin->offset,
-            static_cast<::std::streamsize>(len));
+          write_bases(
+            out, index(bases.read), bases.offset, bases.length, 
+            bases.reverse_complement);
         }
       }
 
@@ -149,21 +468,26 @@ namespace mdbg::graph {
       }
 
       out << "\t"
-          << "LN:i:" << total_len
+          << "LN:i:" << total_len << "\t"
+          << "KC:i:" << kmer_count << "\t"
+          << "RC:i:" << read_count
           << "\n";
     }
 
-    for (auto const& [starting_minimizer, minimizer_node_pairs] : graph) {
-      auto const& [prefix_minimizer, prefix_node] = minimizer_node_pairs.back();
-
-      for (auto const& out_key : prefix_node.out_edges) {
-        out << "L\t" << get_index(starting_minimizer) 
-            << "\t+\t" << get_index(out_key) << "\t+\t"
-            << 0 << "M"
-            << "\n";
-      }
+    if (::mdbg::trace::is_enabled()) {
+      ::mdbg::trace::record("write chunk", chunk_begin, ::mdbg::trace::now());
     }
 
+    ::mdbg::trace::scope const traced_links{"write links"};
+    for_each_link(graph, segments, [&out, &opts](segment_link const& link) {
+      out << "L\t" << link.from
+          << "\t" << (link.from_reverse ? '-' : '+') 
+          << "\t" << link.to
+          << "\t" << (link.to_reverse ? '-' : '+')
+          << "\t" << overlap_length(link.tail, link.tail_node.reverse, opts) << "M"
+          << "\n";
+    });
+
     out << "# cpp-mdbg de Bruijn minimizer graph"
         << "\n"
         << "# "
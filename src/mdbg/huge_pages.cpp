@@ -0,0 +1,79 @@
+#include <mdbg/huge_pages.hpp>
+#include <mdbg/util.hpp>
+
+#include <sys/mman.h>
+
+#include <atomic>
+#include <cstdint>
+
+namespace mdbg::huge_pages {
+
+  namespace {
+
+    bool on = false;
+
+    ::std::atomic<::std::size_t> hugetlb_bytes = 0;
+    ::std::atomic<::std::size_t> transparent_bytes = 0;
+
+    ::std::size_t round_up(::std::size_t const bytes) noexcept {
+      return (bytes + page_size - 1) / page_size * page_size;
+    }
+
+  }
+
+  void enable() noexcept {
+    on = true;
+  }
+
+  bool enabled() noexcept {
+    return on;
+  }
+
+  mapped stats() noexcept {
+    return {hugetlb_bytes.load(), transparent_bytes.load()};
+  }
+
+  void* map(::std::size_t const bytes) noexcept {
+    auto const size = round_up(bytes);
+
+    auto* ptr = ::mmap(nullptr, size, PROT_READ | PROT_WRITE,
+      MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+    if (ptr != MAP_FAILED) {
+      hugetlb_bytes += size;
+      return ptr;
+    }
+
+    // transparent huge pages need the mapping aligned to a huge page,
+    // a page more is mapped and the excess on both ends unmapped
+    ptr = ::mmap(nullptr, size + page_size, PROT_READ | PROT_WRITE,
+      MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (ptr == MAP_FAILED) {
+      ::mdbg::terminate("unable to map ", size, " bytes");
+    }
+
+    auto const begin = reinterpret_cast<::std::uintptr_t>(ptr);
+    auto const aligned = (begin + page_size - 1) / page_size * page_size;
+
+    if (aligned != begin) {
+      ::munmap(ptr, aligned - begin);
+    }
+    if (auto const tail = begin + page_size - aligned; tail != 0) {
+      ::munmap(reinterpret_cast<void*>(aligned + size), tail);
+    }
+
+    ptr = reinterpret_cast<void*>(aligned);
+
+    // fails on kernels without transparent huge pages, normal pages
+    // back the mapping then
+    if (::madvise(ptr, size, MADV_HUGEPAGE) == 0) {
+      transparent_bytes += size;
+    }
+
+    return ptr;
+  }
+
+  void unmap(void* const ptr, ::std::size_t const bytes) noexcept {
+    ::munmap(ptr, round_up(bytes));
+  }
+
+}
@@ -1,27 +1,78 @@
 #include <mdbg/io/parser.hpp>
 #include <mdbg/io/gzreader.hpp>
+#include <mdbg/trace.hpp>
+
+#include <algorithm>
+#include <cstdint>
+#include <filesystem>
+#include <limits>
+#include <utility>
 
 namespace mdbg::io {
 
-  void parse_fasta(char const* file, fasta_constumer& consumer) noexcept {
+  bool read_sampler::keep(::std::string_view const name) const noexcept {
+    if (fraction >= 1) {
+      return true;
+    }
+
+    // FNV-1a, mixed so that similar names spread over the whole range
+    ::std::uint64_t hash = 0xcbf29ce484222325ul;
+    for (auto const c : name) {
+      hash = (hash ^ static_cast<unsigned char>(c)) * 0x100000001b3ul;
+    }
+    hash ^= hash >> 33;
+    hash *= 0xff51afd7ed558ccdul;
+    hash ^= hash >> 33;
+
+    return static_cast<double>(hash) 
+      < fraction * static_cast<double>(::std::numeric_limits<::std::uint64_t>::max());
+  }
+
+  parse_stats parse_fasta(
+    char const* file,
+    fasta_constumer& consumer,
+    read_sampler const& sampler
+  ) noexcept {
     ::std::string name, sequence;
     gzreader reader{file};
+    parse_stats stats;
 
     enum state {
       parsing_name,
       parsing_sequence,
+      skipping_sequence,
       done,
     } current_state = state::parsing_name;
 
     auto view = reader.read();
 
+    // every decompressed chunk is traced from when it is handed
+    // to the parser until the next one is requested
+    auto chunk_begin = ::mdbg::trace::is_enabled() ? ::mdbg::trace::now() : 0;
+    auto const next_chunk = [&reader, &chunk_begin] {
+      if (::mdbg::trace::is_enabled()) {
+        auto const now = ::mdbg::trace::now();
+        ::mdbg::trace::record("parse chunk", chunk_begin, now);
+        chunk_begin = now;
+      }
+      return reader.read();
+    };
+
+    // consumers that copy the read instead of taking it leave the
+    // buffers' capacity to the next one
+    auto const consume = [&consumer, &name, &sequence] {
+      consumer(::std::move(name), ::std::move(sequence));
+      name.clear();
+      sequence.clear();
+    };
+
     ++view.first;
     --view.second;
 
     for (;;) {
       switch (current_state) {
         case state::done:
-          return;
+          return stats;
 
         case state::parsing_name: {
           auto eol = 
@@ -34,6 +85,13 @@ namespace mdbg::io {
             view.second -= static_cast<::std::size_t>(eol - view.first);
             view.first = eol;
 
+            if (!sampler.keep(name)) {
+              name.clear();
+              ++stats.skipped;
+              current_state = state::skipping_sequence;
+              break;
+            }
+
             current_state = state::parsing_sequence;
 
             // [[fallthrough]];
@@ -43,7 +101,7 @@ namespace mdbg::io {
             if (reader.eof()) {
               ::mdbg::terminate("Unexpected EOF in ", file);
             }
-            view = reader.read();
+            view = next_chunk();
 
             break;
           }
@@ -57,16 +115,20 @@ namespace mdbg::io {
 
             if (reader.eof()) {
               current_state = state::done;
-              consumer(::std::exchange(name, {}), ::std::exchange(sequence, {}));
+              consume();
+
+              if (::mdbg::trace::is_enabled()) {
+                ::mdbg::trace::record("parse chunk", chunk_begin, ::mdbg::trace::now());
+              }
             } else {
-              view = reader.read();
+              view = next_chunk();
             }
           } else {
             sequence.append(view.first, ret);
 
             if (*ret == '>') {
               current_state = state::parsing_name;
-              consumer(::std::exchange(name, {}), ::std::exchange(sequence, {}));
+              consume();
             }
 
             ++ret;
@@ -76,8 +138,67 @@ namespace mdbg::io {
 
           break;
         }
+
+        case state::skipping_sequence: {
+          auto const next = reinterpret_cast<char const*>(
+            ::std::memchr(view.first, '>', view.second));
+
+          if (next == nullptr) {
+            if (reader.eof()) {
+              current_state = state::done;
+            } else {
+              view = next_chunk();
+            }
+          } else {
+            current_state = state::parsing_name;
+            view.second -= static_cast<::std::size_t>(next + 1 - view.first);
+            view.first = next + 1;
+          }
+
+          break;
+        }
       }
     }
   }
 
+  double sampling_fraction(char const* file, double const bases) noexcept {
+    // decompressed bytes looked at, enough to average over many reads
+    ::std::size_t constexpr sample = ::std::size_t{1} << 24;
+
+    auto const input = ::gzopen(file, "r");
+    if (input == nullptr) {
+      ::mdbg::terminate("Unable to gzopen ", file);
+    }
+
+    ::std::string buffer(sample, '\0');
+    auto const len = ::gzread(input, buffer.data(), static_cast<unsigned>(sample));
+    if (len == -1) {
+      ::mdbg::terminate("Failed to gzread.");
+    }
+    auto const consumed = static_cast<double>(::gzoffset(input));
+    auto const whole = static_cast<::std::size_t>(len) < sample;
+    ::gzclose_r(input);
+
+    // bases are all characters outside of header lines
+    ::std::size_t sampled = 0;
+    auto header = false;
+    for (::std::size_t i = 0; i < static_cast<::std::size_t>(len); ++i) {
+      auto const c = buffer[i];
+      if (c == '>') {
+        header = true;
+      } else if (c == '\n') {
+        header = false;
+      } else if (!header) {
+        ++sampled;
+      }
+    }
+
+    auto total = static_cast<double>(sampled);
+    if (!whole && consumed > 0) {
+      total *= static_cast<double>(::std::filesystem::file_size(file)) / consumed;
+    }
+
+    return total > 0 ? ::std::min(1.0, bases / total) : 1.0;
+  }
+
 }
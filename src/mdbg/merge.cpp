@@ -0,0 +1,154 @@
+#include <mdbg/merge.hpp>
+#include <mdbg/opt.hpp>
+#include <mdbg/util.hpp>
+#include <mdbg/io/parser.hpp>
+#include <mdbg/graph/construction.hpp>
+#include <mdbg/graph/serialization.hpp>
+#include <mdbg/graph/simplification.hpp>
+
+#include <tsl/robin_map.h>
+#include <tsl/robin_set.h>
+
+#include <tbb/global_control.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <deque>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace mdbg {
+
+  int merge(int argc, char** argv) noexcept {
+    auto const merge_opts = merge_options::parse(argc, argv);
+    auto timer = ::mdbg::timer{};
+
+    ::tbb::global_control max_parallelism{
+      ::tbb::global_control::max_allowed_parallelism, 
+      merge_opts.threads ? merge_opts.threads : ::std::thread::hardware_concurrency()};
+
+    if (merge_opts.dry_run) {
+      ::std::fprintf(stderr, "### DRY RUN  ###\n");
+    }
+
+    // all partitions of the same run have to be present exactly once
+    auto const first = graph::read_header(merge_opts.partitions.front());
+    ::std::vector<bool> present(first.partitions, false);
+
+    for (auto const& path : merge_opts.partitions) {
+      auto const header = graph::read_header(path);
+      if (!graph::same_minimizers(header, first) || header.partitions != first.partitions
+          || header.sample != first.sample) {
+        ::mdbg::terminate(path, " was built with different parameters than ",
+          merge_opts.partitions.front());
+      }
+      if (header.partition >= header.partitions) {
+        ::mdbg::terminate(path, " claims to be partition ", header.partition,
+          " of only ", header.partitions);
+      }
+      if (present[header.partition]) {
+        ::mdbg::terminate("partition ", header.partition, " was given twice");
+      }
+      present[header.partition] = true;
+    }
+
+    for (::std::size_t i = 0; i < present.size(); ++i) {
+      if (!present[i]) {
+        ::mdbg::terminate("partition ", i, " of ", first.partitions, " is missing");
+      }
+    }
+
+    graph::de_bruijn_graph_t dbg;
+    ::std::deque<read_minimizers_t> windows;
+    ::std::vector<graph::detail::compact_minimizer> boundary;
+
+    for (auto const& path : merge_opts.partitions) {
+      graph::load_graph(path, dbg, windows, boundary);
+    }
+
+    // nodes dropped by the abundance filter of their own partition
+    // are still referenced by their neighbours in other partitions
+    auto const dangling = graph::remove_dangling_edges(dbg, boundary);
+
+    ::std::printf(
+      "loaded de Bruijn graph (k = %lu) with %lu node(s) from %lu partition(s), "
+      "removed %lu dangling edge(s) in %ld ms\n",
+      first.k, dbg.size(), first.partitions, dangling, timer.reset_ms());
+    ::std::fflush(stdout);
+
+    auto const simplified = graph::simplify(dbg);
+
+    ::std::printf(
+      "simplified to %lu node(s) in %ld ms\n",
+      simplified.size(), timer.reset_ms());
+    ::std::fflush(stdout);
+
+    if (merge_opts.dry_run) {
+      ::std::quick_exit(EXIT_SUCCESS);
+    }
+
+    command_line_options opts{};
+    opts.k = first.k;
+    opts.l = first.l;
+    opts.d = first.d;
+    opts.scheme = static_cast<minimizer_scheme>(first.scheme);
+    opts.syncmer_s = first.syncmer_s;
+    opts.max_gap = first.max_gap;
+    opts.hpc = first.hpc != 0;
+    opts.sample = first.sample;
+    opts.partitions = 1;
+    opts.sequences = merge_opts.sequences;
+    opts.input = merge_opts.input;
+    opts.output_prefix = merge_opts.output_prefix + ".gfa";
+
+    // only reads some node was taken from are kept
+    ::tsl::robin_map<::std::size_t, ::std::string> sequences;
+
+    if (opts.sequences) {
+      ::tsl::robin_set<::std::size_t> reads;
+      for (auto const& [minimizer, node] : dbg) {
+        reads.insert(minimizer.minimizer->read);
+      }
+
+      ::std::size_t read = 0;
+      ::mdbg::io::fasta_constumer consumer = 
+        [&reads, &sequences, &read](auto&&, auto&& seq) {
+          if (reads.count(read)) {
+            sequences.emplace(read, ::std::forward<::std::string>(seq));
+          }
+          ++read;
+        };
+      // the reads left out by --target-coverage are not numbered
+      ::mdbg::io::parse_fasta(opts.input.c_str(), consumer, {opts.sample});
+
+      ::std::printf(
+        "loaded %lu of %lu sequence(s) in %ld ms\n",
+        sequences.size(), read, timer.reset_ms());
+      ::std::fflush(stdout);
+    }
+
+    ::std::ofstream out{opts.output_prefix};
+    if (!out.is_open()) {
+      ::mdbg::terminate("unable to open/create given output file ", opts.output_prefix);
+    }
+
+    graph::write_gfa(
+      out, 
+      simplified, 
+      [&sequences](auto&& i) -> ::std::string const& { return sequences.at(i); },
+      opts);
+    out.flush();
+
+    ::std::printf(
+      "wrote de Bruijn graph to '%s' in %ld ms\n",
+      opts.output_prefix.c_str(),
+      timer.reset_ms());
+    ::std::fflush(stdout);
+
+    // no side effects other than memory release at this point
+    ::std::quick_exit(EXIT_SUCCESS);
+  }
+
+}
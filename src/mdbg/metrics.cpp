@@ -0,0 +1,145 @@
+#include <mdbg/metrics.hpp>
+#include <mdbg/util.hpp>
+
+#include <sys/resource.h>
+#include <unistd.h>
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <string>
+
+namespace mdbg::metrics {
+
+  namespace {
+
+    ::std::size_t current_rss() noexcept {
+      ::std::ifstream statm{"/proc/self/statm"};
+      ::std::size_t pages = 0, resident = 0;
+
+      if (!(statm >> pages >> resident)) {
+        return 0;
+      }
+
+      return resident * static_cast<::std::size_t>(::sysconf(_SC_PAGESIZE));
+    }
+
+    // kernels without smaps_rollup report no huge pages
+    ::std::size_t current_huge_pages() noexcept {
+      ::std::ifstream smaps{"/proc/self/smaps_rollup"};
+      ::std::string line;
+      ::std::size_t rv = 0;
+
+      // the first line names the mapping, the others read 'Key: n kB'
+      while (::std::getline(smaps, line)) {
+        for (auto const* key : {"AnonHugePages:", "Private_Hugetlb:", "Shared_Hugetlb:"}) {
+          if (line.rfind(key, 0) == 0) {
+            rv += ::std::stoul(line.substr(::std::strlen(key))) * 1024;
+          }
+        }
+      }
+
+      return rv;
+    }
+
+    double ms(::timeval const& tv) noexcept {
+      return static_cast<double>(tv.tv_sec) * 1e3 
+        + static_cast<double>(tv.tv_usec) / 1e3;
+    }
+
+    void write_usage(FILE* out, usage const& u) noexcept {
+      ::std::fprintf(out,
+        "\"wall_ms\": %.3f, \"cpu_ms\": %.3f, "
+        "\"peak_rss_bytes\": %lu, \"rss_bytes\": %lu, \"huge_page_bytes\": %lu",
+        u.wall_ms, u.cpu_ms, u.peak_rss, u.rss, u.huge_pages);
+    }
+
+  }
+
+  usage usage::now() noexcept {
+    ::rusage ru;
+    ::getrusage(RUSAGE_SELF, &ru);
+
+    return {
+      static_cast<double>(
+        ::std::chrono::duration_cast<::std::chrono::microseconds>(
+          ::std::chrono::steady_clock::now().time_since_epoch()).count()) / 1e3,
+      ms(ru.ru_utime) + ms(ru.ru_stime),
+      static_cast<::std::size_t>(ru.ru_maxrss) * 1024,
+      current_rss(),
+      current_huge_pages()
+    };
+  }
+
+  void report::begin(::std::string name) noexcept {
+    auto const now = usage::now();
+    phases.push_back({::std::move(name), now, now, {}});
+  }
+
+  void report::end() noexcept {
+    phases.back().end = usage::now();
+  }
+
+  void report::set(::std::string key, double const value) noexcept {
+    phases.back().values.emplace_back(::std::move(key), value);
+  }
+
+  void report::set_rate(::std::string key, double const value) noexcept {
+    auto const& current = phases.back();
+    auto const seconds = (current.end.wall_ms - current.begin.wall_ms) / 1e3;
+    set(::std::move(key), seconds > 0 ? value / seconds : 0);
+  }
+
+  void report::write(
+    ::std::string const& path,
+    command_line_options const& opts
+  ) const noexcept {
+    FILE* out = ::std::fopen(path.c_str(), "w");
+    if (out == nullptr) {
+      ::mdbg::terminate("unable to open/create metrics file ", path);
+    }
+
+    ::std::fprintf(out,
+      "{\n"
+      "  \"options\": {\"k\": %lu, \"l\": %lu, \"d\": %g, \"threads\": %lu},\n"
+      "  \"phases\": [\n",
+      opts.k, opts.l, opts.d, opts.threads);
+
+    for (::std::size_t i = 0; i < phases.size(); ++i) {
+      auto const& p = phases[i];
+      auto const delta = usage{
+        p.end.wall_ms - p.begin.wall_ms,
+        p.end.cpu_ms - p.begin.cpu_ms,
+        p.end.peak_rss,
+        p.end.rss,
+        p.end.huge_pages
+      };
+
+      ::std::fprintf(out, "    {\"name\": \"%s\", ", p.name.c_str());
+      write_usage(out, delta);
+
+      for (auto const& [key, value] : p.values) {
+        ::std::fprintf(out, ", \"%s\": %.15g", key.c_str(), value);
+      }
+
+      ::std::fprintf(out, i + 1 < phases.size() ? "},\n" : "}\n");
+    }
+
+    auto const total = usage::now();
+
+    ::std::fprintf(out, "  ],\n  \"total\": {");
+    write_usage(out, {
+      total.wall_ms - start.wall_ms,
+      total.cpu_ms - start.cpu_ms,
+      total.peak_rss,
+      total.rss,
+      total.huge_pages
+    });
+    ::std::fprintf(out, "}\n}\n");
+
+    if (::std::fclose(out) != 0) {
+      ::mdbg::terminate("unable to write metrics to ", path);
+    }
+  }
+
+}
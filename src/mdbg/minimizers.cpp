@@ -10,50 +10,369 @@
 #include <cmath>
 #include <cstdint>
 #include <limits>
+#include <string>
+#include <utility>
 
 namespace mdbg {
 
-  ::std::vector<detected_minimizer> detect_minimizers(
-    ::std::string const& seq,
-    ::std::size_t const read_id,
-    command_line_options const& opts
-  ) noexcept {
-    ::std::vector<detected_minimizer> minimizers;
-    ::std::uint64_t hash, rc_hash;
-
-    minimizers.reserve(
-      static_cast<::std::size_t>(static_cast<double>(seq.size()) * opts.d));
-
-    ::std::uint64_t const integer_density =
-      static_cast<::std::uint64_t>(
-        opts.d * 
-          static_cast<decltype(opts.d)>(
-            ::std::numeric_limits<::std::uint64_t>::max()));
-
-    for (::std::size_t i = 0; i < seq.size() - opts.l + 1; ++i) {
-      ::std::uint64_t canonical;
-
-      if (i) {
-        canonical = ::NTC64(
-          static_cast<unsigned char>(seq[i - 1]), 
-          static_cast<unsigned char>(seq[i - 1 + opts.l]),
-          static_cast<unsigned>(opts.l), hash, rc_hash);
+  namespace {
+
+    // minimizers are gathered in a buffer reused by all reads of a
+    // thread, the result is then allocated once at its final size
+    thread_local ::std::vector<detected_minimizer> minimizers;
+
+    // hashes of all l-mers and s-mers of the current read, for the
+    // schemes looking at more than one l-mer at a time
+    thread_local ::std::vector<::std::uint64_t> lmers, smers, syncmers;
+    thread_local ::std::vector<::std::size_t> window_queue;
+    thread_local ::std::vector<bool> picked;
+
+    // with homopolymer compression, the bases each l-mer spans, and the
+    // starts of the last runs along with the first l-mer collapsed
+    struct extent {
+      ::std::uint32_t offset;
+      ::std::uint32_t length;
+    };
+
+    thread_local ::std::vector<extent> extents;
+    thread_local ::std::vector<::std::uint32_t> runs;
+    thread_local ::std::string first_lmer;
+
+    ::std::uint64_t threshold(double const density) noexcept {
+      return density >= 1 
+        ? ::std::numeric_limits<::std::uint64_t>::max()
+        : static_cast<::std::uint64_t>(density * 
+            static_cast<double>(::std::numeric_limits<::std::uint64_t>::max()));
+    }
+
+    // calls f(i, offset, length, hash) with the canonical hash of every
+    // 'length' long substring of seq in order, offset and length being
+    // the bases it spans; L as in detect below
+    template<unsigned L, typename F>
+    void for_each_lmer(
+      ::std::string_view const seq,
+      unsigned const length,
+      F&& f
+    ) noexcept {
+      auto const n = L ? L : length;
+      ::std::uint64_t hash, rc_hash;
+
+      if (seq.size() < n) {
+        return;
+      }
+
+      f(0, 0, n, ::NTC64(seq.data(), n, hash, rc_hash));
+      for (::std::size_t i = 1; i < seq.size() - n + 1; ++i) {
+        f(i, i, n, ::NTC64(
+          static_cast<unsigned char>(seq[i - 1]),
+          static_cast<unsigned char>(seq[i - 1 + n]),
+          n, hash, rc_hash));
+      }
+    }
+
+    // same with every homopolymer run of seq read as a single base, i
+    // counting collapsed l-mers; the run starts of the current l-mer and
+    // the base before it are kept in a ring instead of collapsing seq
+    template<unsigned L, typename F>
+    void for_each_compressed_lmer(
+      ::std::string_view const seq,
+      unsigned const length,
+      F&& f
+    ) noexcept {
+      auto const n = L ? L : length;
+      auto const ring = n + 1;
+      ::std::uint64_t hash, rc_hash;
+
+      runs.resize(ring);
+      ::std::size_t count = 0;
+
+      for (::std::size_t run = 0; run < seq.size();) {
+        auto run_end = run + 1;
+        while (run_end < seq.size() && seq[run_end] == seq[run]) {
+          ++run_end;
+        }
+
+        runs[count % ring] = static_cast<::std::uint32_t>(run);
+        ++count;
+
+        if (count >= n) {
+          ::std::uint64_t canonical;
+
+          if (count == n) {
+            first_lmer.resize(n);
+            for (::std::size_t j = 0; j < n; ++j) {
+              first_lmer[j] = seq[runs[j]];
+            }
+            canonical = ::NTC64(first_lmer.data(), n, hash, rc_hash);
+          } else {
+            canonical = ::NTC64(
+              static_cast<unsigned char>(seq[runs[(count - 1 - n) % ring]]),
+              static_cast<unsigned char>(seq[run]),
+              n, hash, rc_hash);
+          }
+
+          auto const begin = runs[(count - n) % ring];
+          f(count - n, begin, run_end - begin, canonical);
+        }
+
+        run = run_end;
+      }
+    }
+
+    template<unsigned L, typename F>
+    void for_each_lmer(
+      ::std::string_view const seq,
+      unsigned const length,
+      bool const hpc,
+      F&& f
+    ) noexcept {
+      if (hpc) {
+        for_each_compressed_lmer<L>(seq, length, ::std::forward<F>(f));
       } else {
-        canonical = ::NTC64(
-          seq.data(), static_cast<unsigned>(opts.l),
-          hash, rc_hash);
+        for_each_lmer<L>(seq, length, ::std::forward<F>(f));
+      }
+    }
+
+    // canonical hashes of all l-mers, or s-mers, of seq, and with
+    // homopolymer compression the bases the l-mers span
+    template<unsigned L>
+    void hash_all(
+      ::std::string_view const seq,
+      unsigned const length,
+      bool const hpc,
+      bool const spans,
+      ::std::vector<::std::uint64_t>& out
+    ) noexcept {
+      out.clear();
+      if (spans) {
+        extents.clear();
       }
 
-      if (canonical <= integer_density) {
-        minimizers.push_back({
-          read_id, 
-          i,
-          canonical
+      for_each_lmer<L>(seq, length, hpc,
+        [&out, spans](auto, auto const offset, auto const length, auto const hash) {
+          out.push_back(hash);
+          if (spans) {
+            extents.push_back({
+              static_cast<::std::uint32_t>(offset),
+              static_cast<::std::uint32_t>(length)});
+          }
         });
+    }
+
+    // adds the i-th l-mer of the current read as a minimizer
+    void pick(
+      ::std::size_t const read_id,
+      ::std::size_t const i,
+      command_line_options const& opts
+    ) noexcept {
+      auto const [offset, length] = opts.hpc
+        ? extents[i]
+        : extent{static_cast<::std::uint32_t>(i), static_cast<::std::uint32_t>(opts.l)};
+      minimizers.push_back({read_id, offset, length, lmers[i]});
+    }
+
+    // calls f(i, j) for every window of w values starting at i, j being
+    // the position of its smallest value, the rightmost one on ties
+    template<typename F>
+    void for_each_window_min(
+      ::std::vector<::std::uint64_t> const& values,
+      ::std::size_t const w,
+      F&& f
+    ) noexcept {
+      auto& queue = window_queue;
+      ::std::size_t head = 0;
+      queue.clear();
+
+      for (::std::size_t i = 0; i < values.size(); ++i) {
+        while (queue.size() > head && values[queue.back()] >= values[i]) {
+          queue.pop_back();
+        }
+        queue.push_back(i);
+
+        if (queue[head] + w <= i) {
+          ++head;
+        }
+        if (i + 1 >= w) {
+          f(i + 1 - w, queue[head]);
+        }
+      }
+    }
+
+    // l-mers whose smallest s-mer, by value so that ties look the same
+    // on both strands, is at either end (closed) or in the middle (open),
+    // thinned by keeping the smallest of them in every window of 1 / d - 1
+    // l-mers, which keeps their spacing and bounds the gaps by the window
+    // as long as every window holds a syncmer; that is the density of
+    // universe minimizers, canonical hashes fall below d on either strand
+    void pick_syncmers(
+      ::std::size_t const read_id,
+      command_line_options const& opts
+    ) noexcept {
+      auto const w = opts.l - opts.syncmer_s + 1;
+      auto const closed = opts.scheme == minimizer_scheme::closed_syncmer;
+      auto const none = ::std::numeric_limits<::std::uint64_t>::max();
+
+      syncmers.assign(lmers.size(), none);
+      for_each_window_min(smers, w, [&](auto const i, auto const j) {
+        auto const min = smers[j];
+        auto const picked = closed
+          ? smers[i] == min || smers[i + w - 1] == min
+          : smers[i + (w - 1) / 2] == min || smers[i + w / 2] == min;
+
+        if (picked) {
+          syncmers[i] = lmers[i];
+        }
+      });
+
+      // sparser syncmers are all kept
+      auto const window = ::std::max<::std::size_t>(
+        static_cast<::std::size_t>(1 / opts.d), 2) - 1;
+
+      picked.assign(lmers.size(), false);
+      for_each_window_min(syncmers, window, [](auto, auto const j) {
+        if (syncmers[j] != none) {
+          picked[j] = true;
+        }
+      });
+
+      for (::std::size_t i = 0; i < lmers.size(); ++i) {
+        if (picked[i]) {
+          pick(read_id, i, opts);
+        }
+      }
+    }
+
+    // universe minimizers, plus the smallest l-mer of every window of
+    // max_gap ones, which is a universe minimizer unless there is none;
+    // reads shorter than a window only get their universe minimizers
+    void pick_bounded(
+      ::std::size_t const read_id,
+      command_line_options const& opts
+    ) noexcept {
+      auto const universe = threshold(opts.d);
+
+      picked.assign(lmers.size(), false);
+      for_each_window_min(lmers, opts.max_gap, [](auto, auto const j) {
+        picked[j] = true;
+      });
+
+      for (::std::size_t i = 0; i < lmers.size(); ++i) {
+        if (picked[i] || lmers[i] <= universe) {
+          pick(read_id, i, opts);
+        }
       }
     }
 
-    return minimizers;
+    // L of 0 takes the minimizer length from opts, other values compile
+    // it in so that ntHash rotates by constants
+    template<unsigned L>
+    read_minimizers_t detect(
+      ::std::string_view const seq,
+      ::std::size_t const read_id,
+      command_line_options const& opts,
+      ::std::pmr::memory_resource* const resource
+    ) noexcept {
+      auto const l = L ? L : static_cast<unsigned>(opts.l);
+      ::std::uint64_t hash, rc_hash;
+
+      minimizers.clear();
+      minimizers.reserve(
+        static_cast<::std::size_t>(static_cast<double>(seq.size()) * opts.d));
+
+      // the other schemes look at the hashes of many l-mers at a time
+      if (opts.scheme != minimizer_scheme::universe) {
+        hash_all<L>(seq, l, opts.hpc, opts.hpc, lmers);
+
+        if (opts.scheme == minimizer_scheme::bounded) {
+          pick_bounded(read_id, opts);
+        } else {
+          hash_all<0>(seq, static_cast<unsigned>(opts.syncmer_s), opts.hpc, false, smers);
+          pick_syncmers(read_id, opts);
+        }
+
+        return read_minimizers_t{minimizers.begin(), minimizers.end(), resource};
+      }
+
+      ::std::uint64_t const integer_density =
+        static_cast<::std::uint64_t>(
+          opts.d * 
+            static_cast<decltype(opts.d)>(
+              ::std::numeric_limits<::std::uint64_t>::max()));
+
+      if (opts.hpc) {
+        for_each_compressed_lmer<L>(seq, l,
+          [read_id, integer_density](auto, auto const offset, auto const length, auto const hash) {
+            if (hash <= integer_density) {
+              minimizers.push_back({
+                read_id,
+                static_cast<::std::uint32_t>(offset),
+                static_cast<::std::uint32_t>(length),
+                hash
+              });
+            }
+          });
+
+        return read_minimizers_t{minimizers.begin(), minimizers.end(), resource};
+      }
+
+      for (::std::size_t i = 0; i < seq.size() - l + 1; ++i) {
+        ::std::uint64_t canonical;
+
+        if (i) {
+          canonical = ::NTC64(
+            static_cast<unsigned char>(seq[i - 1]), 
+            static_cast<unsigned char>(seq[i - 1 + l]),
+            l, hash, rc_hash);
+        } else {
+          canonical = ::NTC64(seq.data(), l, hash, rc_hash);
+        }
+
+        if (canonical <= integer_density) {
+          minimizers.push_back({
+            read_id, 
+            static_cast<::std::uint32_t>(i),
+            l,
+            canonical
+          });
+        }
+      }
+
+      return read_minimizers_t{minimizers.begin(), minimizers.end(), resource};
+    }
+
+  }
+
+  read_minimizers_t detect_minimizers(
+    ::std::string_view const seq,
+    ::std::size_t const read_id,
+    command_line_options const& opts,
+    ::std::pmr::memory_resource* const resource
+  ) noexcept {
+    if (seq.size() > ::std::numeric_limits<::std::uint32_t>::max()) {
+      ::mdbg::terminate("Read ", read_id, " is longer than the supported 4 Gb.");
+    }
+
+    switch (opts.l) {
+      case 7:
+        return detect<7>(seq, read_id, opts, resource);
+      case 14:
+        return detect<14>(seq, read_id, opts, resource);
+      case 21:
+        return detect<21>(seq, read_id, opts, resource);
+      case 31:
+        return detect<31>(seq, read_id, opts, resource);
+      default:
+        return detect<0>(seq, read_id, opts, resource);
+    }
+  }
+
+  read_minimizers_t detail::detect_minimizers_generic(
+    ::std::string_view const seq,
+    ::std::size_t const read_id,
+    command_line_options const& opts,
+    ::std::pmr::memory_resource* const resource
+  ) noexcept {
+    return detect<0>(seq, read_id, opts, resource);
   }
 
 }
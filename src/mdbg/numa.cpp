@@ -0,0 +1,40 @@
+#include <mdbg/numa.hpp>
+
+#include <tbb/info.h>
+
+#include <algorithm>
+
+namespace mdbg::numa {
+
+  node_arenas::node_arenas(::std::size_t const max_threads) noexcept {
+    auto const ids = ::tbb::info::numa_nodes();
+
+    // the thread budget is split over the nodes by their core counts
+    ::std::size_t total = 0;
+    for (auto const id : ids) {
+      total += static_cast<::std::size_t>(::tbb::info::default_concurrency(id));
+    }
+    auto const budget = max_threads ? ::std::min(max_threads, total) : total;
+
+    for (auto const id : ids) {
+      auto const cores = static_cast<::std::size_t>(::tbb::info::default_concurrency(id));
+      auto const threads = ::std::max<::std::size_t>(1, budget * cores / total);
+
+      ::tbb::task_arena::constraints constraints{id, static_cast<int>(threads)};
+      nodes.push_back(::std::make_unique<node>(constraints));
+    }
+  }
+
+  void node_arenas::wait() noexcept {
+    // a task waited for on one node may have run another one on a node
+    // that was already waited for, so all nodes are waited for once more
+    for (::std::size_t round = 0; round < 2; ++round) {
+      for (auto& target : nodes) {
+        target->arena.execute([&target] {
+          target->tasks.wait();
+        });
+      }
+    }
+  }
+
+}
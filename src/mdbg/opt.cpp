@@ -5,6 +5,8 @@
 
 #include <filesystem>
 #include <stdexcept>
+#include <tuple>
+#include <utility>
 
 namespace mdbg {
 
@@ -47,6 +49,118 @@ namespace mdbg {
     return rv;
   }
 
+  // number of bytes with an optional K, M, G or T suffix
+  ::std::size_t parse_size(::std::string const& arg) noexcept {
+    ::std::size_t end = 0;
+    ::std::size_t rv = 0;
+
+    try {
+      rv = ::std::stoul(arg, &end);
+    } catch (::std::logic_error const&) {
+      ::mdbg::terminate("Expected a size such as 512M or 64G, got '", arg, "'.");
+    }
+
+    if (end == arg.size()) {
+      return rv;
+    }
+
+    if (end + 1 != arg.size()) {
+      ::mdbg::terminate("Expected a size such as 512M or 64G, got '", arg, "'.");
+    }
+
+    switch (arg[end]) {
+      case 'T': case 't': rv <<= 10; [[fallthrough]];
+      case 'G': case 'g': rv <<= 10; [[fallthrough]];
+      case 'M': case 'm': rv <<= 10; [[fallthrough]];
+      case 'K': case 'k': rv <<= 10; break;
+      default:
+        ::mdbg::terminate("Unknown size suffix in '", arg, "'.");
+    }
+
+    return rv;
+  }
+
+  // number of bases with an optional k, m or g suffix, e.g. 3.1g
+  double parse_bases(::std::string const& arg) noexcept {
+    ::std::size_t end = 0;
+    double rv = 0;
+
+    try {
+      rv = ::std::stod(arg, &end);
+    } catch (::std::logic_error const&) {
+      ::mdbg::terminate("Expected a genome size such as 4.6m or 3.1g, got '", arg, "'.");
+    }
+
+    if (end != arg.size()) {
+      if (end + 1 != arg.size()) {
+        ::mdbg::terminate("Expected a genome size such as 4.6m or 3.1g, got '", arg, "'.");
+      }
+
+      switch (arg[end]) {
+        case 'G': case 'g': rv *= 1e9; break;
+        case 'M': case 'm': rv *= 1e6; break;
+        case 'K': case 'k': rv *= 1e3; break;
+        default:
+          ::mdbg::terminate("Unknown genome size suffix in '", arg, "'.");
+      }
+    }
+
+    return rv;
+  }
+
+  // "i/N" with i < N
+  ::std::pair<::std::size_t, ::std::size_t> parse_partition(
+    ::std::string const& arg
+  ) noexcept {
+    auto const separator = arg.find('/');
+    ::std::size_t partition = 0, partitions = 0;
+
+    try {
+      if (separator != ::std::string::npos) {
+        partition = ::std::stoul(arg.substr(0, separator));
+        partitions = ::std::stoul(arg.substr(separator + 1));
+      }
+    } catch (::std::logic_error const&) {
+      partitions = 0;
+    }
+
+    if (partitions == 0 || partition >= partitions) {
+      ::mdbg::terminate("Expected partition as i/N with i < N, got '", arg, "'.");
+    }
+
+    return {partition, partitions};
+  }
+
+  char const* scheme_name(minimizer_scheme const scheme) noexcept {
+    switch (scheme) {
+      case minimizer_scheme::closed_syncmer: return "closed-syncmer";
+      case minimizer_scheme::open_syncmer: return "open-syncmer";
+      case minimizer_scheme::bounded: return "bounded";
+      default: return "universe";
+    }
+  }
+
+  namespace {
+
+    minimizer_scheme parse_scheme(::std::string const& arg) noexcept {
+      if (arg == "universe") {
+        return minimizer_scheme::universe;
+      }
+      if (arg == "closed-syncmer") {
+        return minimizer_scheme::closed_syncmer;
+      }
+      if (arg == "open-syncmer") {
+        return minimizer_scheme::open_syncmer;
+      }
+      if (arg == "bounded") {
+        return minimizer_scheme::bounded;
+      }
+      ::mdbg::terminate("Unknown minimizer scheme '", arg, "', expected universe, "
+        "closed-syncmer, open-syncmer or bounded.");
+    }
+
+  }
+
   command_line_options command_line_options::parse(int argc, char** argv) noexcept {
     ::cxxopts::Options options(
         "mdbg", 
@@ -61,8 +175,91 @@ namespace mdbg {
         ::cxxopts::value<::std::size_t>()->default_value("33"))
       ("l,letters", "Length of the minimizers.",
         ::cxxopts::value<::std::size_t>()->default_value("14"))
-      ("d,density", "Density of the universe minimizers.",
+      ("d,density", "Density of the minimizers.",
         ::cxxopts::value<double>()->default_value("0.005"))
+      ("scheme",
+        "Minimizer scheme, one of universe, closed-syncmer, open-syncmer "
+        "or bounded. All of them pick minimizers with a density of d.",
+        ::cxxopts::value<::std::string>()->default_value("universe"))
+      ("syncmer-s",
+        "Length of the s-mers of syncmers. "
+        "NOTE: Default of 0 uses l / 2.",
+        ::cxxopts::value<::std::size_t>()->default_value("0"))
+      ("max-gap",
+        "Largest gap in bases between minimizers of the bounded scheme. "
+        "NOTE: Default of 0 uses 2 / d.",
+        ::cxxopts::value<::std::size_t>()->default_value("0"))
+      ("hpc",
+        "Pick minimizers from the reads with every homopolymer run collapsed "
+        "into a single base, so that errors in run lengths do not change them.",
+        ::cxxopts::value<bool>()
+          ->default_value("0")
+          ->implicit_value("1"))
+      ("min-abundance",
+        "Remove nodes seen in fewer than N windows before simplification.",
+        ::cxxopts::value<::std::size_t>()->default_value("1"))
+      ("remove-contained",
+        "Detect the minimizers of all reads first and leave out duplicate "
+        "reads and reads contained in longer ones, in minimizer space, "
+        "when building the graph. Can not be used with --min-abundance.",
+        ::cxxopts::value<bool>()
+          ->default_value("0")
+          ->implicit_value("1"))
+      ("target-coverage",
+        "Keep only enough reads for the given coverage of --genome-size, "
+        "picked by a hash of their names so that reruns keep the same ones. "
+        "NOTE: Default of 0 keeps all reads.",
+        ::cxxopts::value<double>()->default_value("0"))
+      ("genome-size",
+        "Genome size in bases for --target-coverage, e.g. 4.6m or 3.1g.",
+        ::cxxopts::value<::std::string>()->default_value("0"))
+      ("clip-tips",
+        "Remove dead end unitigs shorter than N bases after simplification. "
+        "NOTE: Default of 0 disables clipping.",
+        ::cxxopts::value<::std::size_t>()->default_value("0"))
+      ("pop-bubbles",
+        "Pop bubbles with branches shorter than N bases after simplification, "
+        "keeping the best covered branch. "
+        "NOTE: Default of 0 disables popping.",
+        ::cxxopts::value<::std::size_t>()->default_value("0"))
+      ("break-loops",
+        "Remove self links and duplicate links between two unitigs "
+        "after simplification.",
+        ::cxxopts::value<bool>()
+          ->default_value("0")
+          ->implicit_value("1"))
+      ("max-memory",
+        "Build the graph in partitions streamed through disk so that "
+        "it fits into the given memory, e.g. 64G. "
+        "NOTE: Default of 0 builds the whole graph in memory.",
+        ::cxxopts::value<::std::string>()->default_value("0"))
+      ("partition",
+        "Format: i/N\n"
+        "Build only the nodes of partition i out of N and write them "
+        "to output.i-of-N.partition for 'mdbg merge'.",
+        ::cxxopts::value<::std::string>()->default_value("0/1"))
+      ("save-graph",
+        "Also write the construction graph and its unitigs to "
+        "output.graph and output.unitigs for --add-to.",
+        ::cxxopts::value<bool>()
+          ->default_value("0")
+          ->implicit_value("1"))
+      ("add-to",
+        "Add the input reads to the graph saved with --save-graph under "
+        "the given output prefix, recomputing only the unitigs they touch.",
+        ::cxxopts::value<::std::string>()->default_value(""))
+      ("numa",
+        "Pin workers to NUMA nodes and merge every node of the graph on "
+        "the NUMA node owning it, for multi socket machines.",
+        ::cxxopts::value<bool>()
+          ->default_value("0")
+          ->implicit_value("1"))
+      ("huge-pages",
+        "Back the graph tables and minimizer storage with huge pages, from "
+        "the hugetlbfs pool if it is large enough, else transparent ones.",
+        ::cxxopts::value<bool>()
+          ->default_value("0")
+          ->implicit_value("1"))
       ("a,analysis",
         "Exit after outputting minimizer statistics for given reads.",
         ::cxxopts::value<bool>()
@@ -77,12 +274,19 @@ namespace mdbg {
         ::cxxopts::value<bool>()
           ->default_value("0")
           ->implicit_value("1"))
-      // ("c,check-collisions",
-      //  "Check for node collisions when building the de Bruijn graph. "
-      //  "Incurs runtime overhead!",
-      //   ::cxxopts::value<bool>()
-      //     ->default_value("0")
-      //     ->implicit_value("1"))
+      ("trace",
+        "Write a Chrome trace of all tasks per worker thread to the given file.",
+        ::cxxopts::value<::std::string>()->default_value(""))
+      ("c,check-collisions",
+        "Check for node collisions when building the de Bruijn graph. "
+        "Incurs runtime overhead!",
+        ::cxxopts::value<bool>()
+          ->default_value("0")
+          ->implicit_value("1"))
+      ("check-collisions-sample",
+        "Check for node collisions only in the given fraction of windows, "
+        "sampled by hash; implies -c.",
+        ::cxxopts::value<double>()->default_value("0"))
       ("i,input", "Input reads.", ::cxxopts::value<::std::string>())
       ("o,output", "Output prefix for the graph(s) formatted as GFA.",
         ::cxxopts::value<::std::string>())
@@ -112,10 +316,40 @@ namespace mdbg {
       rv.l = r["l"].as<decltype(rv.l)>();
       rv.d = r["d"].as<decltype(rv.d)>();
 
+      rv.scheme = parse_scheme(r["scheme"].as<::std::string>());
+      rv.syncmer_s = r["syncmer-s"].as<decltype(rv.syncmer_s)>();
+      rv.max_gap = r["max-gap"].as<decltype(rv.max_gap)>();
+
+      rv.hpc = r["hpc"].as<decltype(rv.hpc)>();
+
+      rv.min_abundance = r["min-abundance"].as<decltype(rv.min_abundance)>();
+      rv.remove_contained = r["remove-contained"].as<decltype(rv.remove_contained)>();
+      rv.target_coverage = r["target-coverage"].as<decltype(rv.target_coverage)>();
+      rv.genome_size = parse_bases(r["genome-size"].as<::std::string>());
+
+      if (rv.target_coverage < 0 || (rv.target_coverage > 0) != (rv.genome_size > 0)) {
+        ::mdbg::terminate("--target-coverage and --genome-size have to be given together.");
+      }
+      rv.clip_tips = r["clip-tips"].as<decltype(rv.clip_tips)>();
+      rv.pop_bubbles = r["pop-bubbles"].as<decltype(rv.pop_bubbles)>();
+      rv.break_loops = r["break-loops"].as<decltype(rv.break_loops)>();
+      rv.max_memory = parse_size(r["max-memory"].as<::std::string>());
+
+      ::std::tie(rv.partition, rv.partitions) = 
+        parse_partition(r["partition"].as<::std::string>());
+
+      rv.numa = r["numa"].as<decltype(rv.numa)>();
+      rv.huge_pages = r["huge-pages"].as<decltype(rv.huge_pages)>();
       rv.analysis = r["analysis"].as<decltype(rv.analysis)>();
       rv.dry_run = r["dry-run"].as<decltype(rv.dry_run)>();
       rv.sequences = r["sequences"].as<decltype(rv.sequences)>();
-      // rv.check_collisions = r["check-collisions"].as<decltype(rv.check_collisions)>();
+      rv.save_graph = r["save-graph"].as<decltype(rv.save_graph)>();
+      rv.add_to = r["add-to"].as<decltype(rv.add_to)>();
+      rv.trace = r["trace"].as<decltype(rv.trace)>();
+      rv.check_collisions = r["check-collisions"].as<bool>() ? 1 : 0;
+      if (auto const sample = r["check-collisions-sample"].as<double>(); sample != 0) {
+        rv.check_collisions = sample;
+      }
 
       if (auto const& trio_binning_arg = r["trio-binning"].as<::std::string>();
           trio_binning_arg.length() > 0) {
@@ -128,6 +362,120 @@ namespace mdbg {
       ::mdbg::terminate(exc.what());
     }
 
+    rv.resolve_defaults();
+
+    return rv;
+  }
+
+  void command_line_options::resolve_defaults() noexcept {
+    if (k == 0 || l == 0 || !(d > 0 && d <= 1)) {
+      ::mdbg::terminate("-k and -l have to be at least 1 and -d between 0 and 1.");
+    }
+
+    if (syncmer_s == 0) {
+      syncmer_s = l / 2;
+    }
+    if (max_gap == 0) {
+      max_gap = static_cast<::std::size_t>(2 / d);
+    }
+
+    if (syncmer_s == 0 || syncmer_s > l) {
+      ::mdbg::terminate("Syncmer s-mers have to be between 1 and l long.");
+    }
+
+    if (partitions == 0 || partition >= partitions) {
+      ::mdbg::terminate("Expected partition i of N with i < N.");
+    }
+
+    if (partitions > 1 && (max_memory || clip_tips || pop_bubbles || break_loops)) {
+      ::mdbg::terminate("Partitions are simplified by 'mdbg merge', "
+        "--partition can not be used with --max-memory or graph cleanup.");
+    }
+
+    if (max_memory && (clip_tips || pop_bubbles || break_loops)) {
+      ::mdbg::terminate("Graph cleanup needs the whole graph, it can not be used with --max-memory.");
+    }
+
+    if ((save_graph || !add_to.empty()) && (max_memory || partitions > 1)) {
+      ::mdbg::terminate("Incremental assembly needs the whole graph, "
+        "--save-graph and --add-to can not be used with --max-memory or --partition.");
+    }
+
+    // bases of earlier reads are not kept with the saved graph
+    if (!add_to.empty() && sequences) {
+      ::mdbg::terminate("Sequences can not be spelled when adding to a saved graph.");
+    }
+
+    // left out reads would no longer count towards the abundance of the
+    // nodes they share with the reads containing them
+    if (remove_contained && min_abundance > 1) {
+      ::mdbg::terminate("Reads left out by --remove-contained do not count towards node "
+        "abundance, it can not be used with --min-abundance.");
+    }
+
+    if (check_collisions < 0 || check_collisions > 1) {
+      ::mdbg::terminate("--check-collisions-sample takes a fraction between 0 and 1.");
+    }
+
+    if (max_memory && check_collisions > 0) {
+      ::mdbg::terminate("Collisions are checked while building the graph in memory, "
+        "--check-collisions can not be used with --max-memory.");
+    }
+  }
+
+  merge_options merge_options::parse(int argc, char** argv) noexcept {
+    ::cxxopts::Options options(
+        "mdbg merge", 
+        "Joins partitions built with --partition and writes the simplified graph.");
+
+    options.add_options()
+      ("t,threads", 
+        "Maximum number of concurrent threads. "
+        "NOTE: Default of 0 means max concurrency.",
+        ::cxxopts::value<::std::size_t>()->default_value("0"))
+      ("dry-run", "Dry run, do not write.",
+        ::cxxopts::value<bool>()
+          ->default_value("0")
+          ->implicit_value("1"))
+      ("s,sequences", 
+        "Output sequences contained within minimizers in output GFA, "
+        "requires the input reads.",
+        ::cxxopts::value<bool>()
+          ->default_value("0")
+          ->implicit_value("1"))
+      ("i,input", "Input reads the partitions were built from.",
+        ::cxxopts::value<::std::string>()->default_value(""))
+      ("o,output", "Output prefix for the graph formatted as GFA.",
+        ::cxxopts::value<::std::string>())
+      ("p,partitions", "Partition files.",
+        ::cxxopts::value<::std::vector<::std::string>>());
+
+    options.parse_positional({"output", "partitions"});
+    options.positional_help("output.gfa partitions...");
+
+    if (argc <= 1) {
+      ::mdbg::terminate(options.help());
+    }
+
+    merge_options rv{};
+
+    try {
+      auto r = options.parse(argc, argv);
+
+      rv.threads = r["threads"].as<decltype(rv.threads)>();
+      rv.dry_run = r["dry-run"].as<decltype(rv.dry_run)>();
+      rv.sequences = r["sequences"].as<decltype(rv.sequences)>();
+      rv.input = r["input"].as<decltype(rv.input)>();
+      rv.output_prefix = r["output"].as<decltype(rv.output_prefix)>();
+      rv.partitions = r["partitions"].as<decltype(rv.partitions)>();
+    } catch (::cxxopts::OptionException const& exc) {
+      ::mdbg::terminate(exc.what());
+    }
+
+    if (rv.sequences && rv.input.empty()) {
+      ::mdbg::terminate("Spelling sequences needs the input reads, pass them with -i.");
+    }
+
     return rv;
   }
 
@@ -137,9 +485,37 @@ namespace mdbg {
     out << "command_line_options(k=" << opts.k
         << ", l=" << opts.l
         << ", d=" << opts.d
+        << ", scheme=" << scheme_name(opts.scheme)
+        << ", syncmer-s=" << opts.syncmer_s
+        << ", max-gap=" << opts.max_gap
+        << ", hpc=" << opts.hpc
+        << ", min-abundance=" << opts.min_abundance
+        << ", remove-contained=" << opts.remove_contained
+        << ", target-coverage=" << opts.target_coverage
+        << ", genome-size=" << opts.genome_size
+        << ", sample=" << opts.sample
+        << ", clip-tips=" << opts.clip_tips
+        << ", pop-bubbles=" << opts.pop_bubbles
+        << ", break-loops=" << opts.break_loops
+        << ", max-memory=" << opts.max_memory
+        << ", partition=" << opts.partition << "/" << opts.partitions
+        << ", numa=" << opts.numa
+        << ", huge-pages=" << opts.huge_pages
+        << ", save-graph=" << opts.save_graph
+        << ", add-to=" << (opts.add_to.empty() ? "none" : opts.add_to)
         << ", sequences=" << opts.sequences
-        << ", input=" << ::std::filesystem::absolute(opts.input)
-        << ", output=" << ::std::filesystem::absolute(opts.output_prefix)
+        << ", check-collisions=" << opts.check_collisions
+        << ", trace=" << (opts.trace.empty() ? "none" : opts.trace)
+        << ", input=";
+
+    // 'mdbg merge' does not need the reads
+    if (opts.input.empty()) {
+      out << "none";
+    } else {
+      out << ::std::filesystem::absolute(opts.input);
+    }
+
+    out << ", output=" << ::std::filesystem::absolute(opts.output_prefix)
         << ", trio-binning=";
 
     if (opts.trio_binning.has_value()) {
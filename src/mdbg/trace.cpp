@@ -0,0 +1,114 @@
+#include <mdbg/trace.hpp>
+#include <mdbg/util.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <vector>
+
+#include <tbb/enumerable_thread_specific.h>
+
+namespace mdbg::trace {
+
+  namespace {
+
+    struct event {
+      char const* name;
+      ::std::int64_t begin;
+      ::std::int64_t end;
+    };
+
+    ::std::atomic<::std::size_t> next_thread_id = 0;
+    ::std::size_t buffer_capacity = 0;
+    ::std::chrono::steady_clock::time_point start;
+
+    // written only by its owning thread
+    struct ring_buffer {
+      ::std::size_t const thread_id = next_thread_id++;
+      ::std::vector<event> events = ::std::vector<event>(buffer_capacity);
+      ::std::size_t head = 0;
+
+      void push(event const& e) noexcept {
+        events[head % events.size()] = e;
+        ++head;
+      }
+    };
+
+    using buffers_t = ::tbb::enumerable_thread_specific<ring_buffer>;
+
+    buffers_t& buffers() noexcept {
+      static buffers_t rv;
+      return rv;
+    }
+
+  }
+
+  void enable(::std::size_t const capacity) noexcept {
+    buffer_capacity = capacity;
+    start = ::std::chrono::steady_clock::now();
+    detail::enabled.store(true);
+  }
+
+  ::std::int64_t now() noexcept {
+    return ::std::chrono::duration_cast<::std::chrono::nanoseconds>(
+      ::std::chrono::steady_clock::now() - start).count();
+  }
+
+  void record(
+    char const* name,
+    ::std::int64_t const begin,
+    ::std::int64_t const end
+  ) noexcept {
+    thread_local ring_buffer* buffer = &buffers().local();
+    buffer->push({name, begin, end});
+  }
+
+  void write(::std::string const& path) noexcept {
+    FILE* out = ::std::fopen(path.c_str(), "w");
+    if (out == nullptr) {
+      ::mdbg::terminate("unable to open/create trace file ", path);
+    }
+
+    ::std::fprintf(out, "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [\n");
+
+    bool first = true;
+    auto const separator = [&first, out] {
+      ::std::fprintf(out, first ? "  " : ",\n  ");
+      first = false;
+    };
+
+    for (auto const& buffer : buffers()) {
+      separator();
+      ::std::fprintf(out,
+        "{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 0, \"tid\": %lu, "
+        "\"args\": {\"name\": \"worker %lu\"}}",
+        buffer.thread_id, buffer.thread_id);
+
+      auto const size = ::std::min(buffer.head, buffer.events.size());
+      for (auto i = buffer.head - size; i < buffer.head; ++i) {
+        auto const& e = buffer.events[i % buffer.events.size()];
+
+        separator();
+        ::std::fprintf(out,
+          "{\"name\": \"%s\", \"ph\": \"X\", \"pid\": 0, \"tid\": %lu, "
+          "\"ts\": %.3f, \"dur\": %.3f}",
+          e.name, buffer.thread_id,
+          static_cast<double>(e.begin) / 1e3,
+          static_cast<double>(e.end - e.begin) / 1e3);
+      }
+
+      if (buffer.head > size) {
+        ::std::fprintf(stderr,
+          "trace: worker %lu dropped %lu oldest event(s)\n",
+          buffer.thread_id, buffer.head - size);
+      }
+    }
+
+    ::std::fprintf(out, "\n]}\n");
+
+    if (::std::fclose(out) != 0) {
+      ::mdbg::terminate("unable to write trace to ", path);
+    }
+  }
+
+}
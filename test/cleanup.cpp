@@ -0,0 +1,99 @@
+#include <catch2/catch.hpp>
+
+#include <mdbg/assembler.hpp>
+#include <mdbg/opt.hpp>
+#include <mdbg/sim/read_sim.hpp>
+
+#include <string>
+#include <vector>
+
+namespace {
+
+  ::mdbg::command_line_options tip_options() {
+    ::mdbg::command_line_options opts{};
+    opts.threads = 1;
+    opts.k = 10;
+    opts.l = 14;
+    opts.d = 0.1;
+    opts.clip_tips = 1000;
+    return opts;
+  }
+
+  // assembles the reads with tips clipped, returns the spelled unitigs
+  // and the number of clipped tips
+  ::std::vector<::std::string> clip(
+    ::std::vector<::std::string> const& reads,
+    ::std::size_t& tips
+  ) {
+    ::mdbg::assembler assembler{tip_options()};
+    for (auto const& read : reads) {
+      assembler.push(read);
+    }
+
+    ::mdbg::assembly_hooks hooks;
+    tips = 0;
+    hooks.cleaned = [&tips](auto const& cleaned, auto const&) { tips += cleaned.tips; };
+
+    auto const assembly = assembler.finish(hooks);
+
+    ::std::vector<::std::string> rv;
+    for (auto const& unitig : assembly.unitigs()) {
+      ::std::string spelled;
+      assembly.for_each_piece(unitig, [&spelled](auto const piece, bool const rc) {
+        ::std::string bases{piece};
+        if (rc) {
+          ::mdbg::sim::detail::reverse_complement(bases);
+        }
+        spelled += bases;
+      });
+      rv.push_back(spelled);
+    }
+    return rv;
+  }
+
+  bool spells(::std::vector<::std::string> const& unitigs, ::std::string junction) {
+    for (auto const& unitig : unitigs) {
+      if (unitig.find(junction) != ::std::string::npos) {
+        return true;
+      }
+    }
+    ::mdbg::sim::detail::reverse_complement(junction);
+    for (auto const& unitig : unitigs) {
+      if (unitig.find(junction) != ::std::string::npos) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+}
+
+TEST_CASE("Tip beside a longer path", "[cleanup]") {
+  auto const shared = ::mdbg::sim::random_genome(3000, 1);
+  auto const path = ::mdbg::sim::random_genome(2000, 2);
+  auto const tip = ::mdbg::sim::random_genome(300, 3);
+
+  ::std::size_t tips;
+  auto const unitigs = clip({path + shared, tip + shared}, tips);
+
+  REQUIRE(tips == 1);
+  REQUIRE(unitigs.size() == 1);
+  REQUIRE(spells(unitigs, path.substr(1900) + shared.substr(0, 100)));
+  REQUIRE(!spells(unitigs, tip.substr(200) + shared.substr(0, 100)));
+}
+
+TEST_CASE("Sibling tips", "[cleanup]") {
+  // reads ending differently at the end of a chromosome, one of the
+  // ends has to stay
+  auto const shared = ::mdbg::sim::random_genome(3000, 1);
+  auto const first = ::mdbg::sim::random_genome(300, 2);
+  auto const second = ::mdbg::sim::random_genome(300, 3);
+
+  ::std::size_t tips;
+  auto const unitigs = clip({first + shared, second + shared}, tips);
+
+  REQUIRE(tips == 1);
+  REQUIRE(unitigs.size() == 1);
+  REQUIRE((spells(unitigs, first.substr(200) + shared.substr(0, 100))
+    != spells(unitigs, second.substr(200) + shared.substr(0, 100))));
+}
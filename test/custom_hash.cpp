@@ -24,6 +24,101 @@ TEST_CASE("Basic", "[128 bit hash]") {
   }
 }
 
+TEST_CASE("Reversed", "[128 bit hash]") {
+  for (::std::size_t k = 1; k < ::sequence.size(); ++k) {
+    ::mdbg::hash128 hash{
+      ::sequence.rend() - static_cast<long>(k),
+      ::sequence.rend()
+    };
+
+    for (::std::size_t i = k; i < ::sequence.size(); ++i) {
+      hash.rotate_reversed(::sequence[i], ::sequence[i - k], k);
+      REQUIRE(hash == ::mdbg::hash128{
+        ::sequence.rend() - static_cast<long>(i) - 1,
+        ::sequence.rend() - static_cast<long>(i - k) - 1
+      });
+    }
+  }
+}
+
+namespace {
+
+  template<::mdbg::shift_range R>
+  void require_shift_range(::std::size_t const k) {
+    ::mdbg::hash128 forward{
+      ::sequence.begin(),
+      ::sequence.begin() + static_cast<long>(k)
+    };
+    ::mdbg::hash128 reversed{
+      ::sequence.rend() - static_cast<long>(k),
+      ::sequence.rend()
+    };
+
+    for (::std::size_t i = k; i < ::sequence.size(); ++i) {
+      forward.rotate<R>(::sequence[i], ::sequence[i - k], k);
+      reversed.rotate_reversed<R>(::sequence[i], ::sequence[i - k], k);
+      REQUIRE(forward == ::mdbg::hash128{
+        ::sequence.begin() + static_cast<long>(i - k) + 1,
+        ::sequence.begin() + static_cast<long>(i) + 1
+      });
+      REQUIRE(reversed == ::mdbg::hash128{
+        ::sequence.rend() - static_cast<long>(i) - 1,
+        ::sequence.rend() - static_cast<long>(i - k) - 1
+      });
+    }
+  }
+
+}
+
+TEST_CASE("Shift ranges", "[128 bit hash]") {
+  for (::std::size_t k = 1; k < ::sequence.size(); ++k) {
+    switch (::mdbg::shift_range_of(k)) {
+      case ::mdbg::shift_range::below_64:
+        require_shift_range<::mdbg::shift_range::below_64>(k);
+        break;
+      case ::mdbg::shift_range::above_64:
+        require_shift_range<::mdbg::shift_range::above_64>(k);
+        break;
+      default:
+        require_shift_range<::mdbg::shift_range::any>(k);
+    }
+  }
+}
+
+TEST_CASE("Basic 64 bit", "[64 bit hash]") {
+  for (::std::size_t k = 1; k < ::sequence.size(); ++k) {
+    ::mdbg::hash64 hash{
+      ::sequence.begin(),
+      ::sequence.begin() + static_cast<long>(k)
+    };
+
+    for (::std::size_t i = k; i < ::sequence.size(); ++i) {
+      hash.rotate(::sequence[i], ::sequence[i - k], k);
+      REQUIRE(hash == ::mdbg::hash64{
+        ::sequence.begin() + static_cast<long>(i - k) + 1,
+        ::sequence.begin() + static_cast<long>(i) + 1
+      });
+    }
+  }
+}
+
+TEST_CASE("Reversed 64 bit", "[64 bit hash]") {
+  for (::std::size_t k = 1; k < ::sequence.size(); ++k) {
+    ::mdbg::hash64 hash{
+      ::sequence.rend() - static_cast<long>(k),
+      ::sequence.rend()
+    };
+
+    for (::std::size_t i = k; i < ::sequence.size(); ++i) {
+      hash.rotate_reversed(::sequence[i], ::sequence[i - k], k);
+      REQUIRE(hash == ::mdbg::hash64{
+        ::sequence.rend() - static_cast<long>(i) - 1,
+        ::sequence.rend() - static_cast<long>(i - k) - 1
+      });
+    }
+  }
+}
+
 // sequence.size() > 128
 ::std::vector<::std::uint64_t> sequence{
   2183138153721051810ull,
@@ -0,0 +1,123 @@
+#include <catch2/catch.hpp>
+
+#include <mdbg/assembler.hpp>
+#include <mdbg/opt.hpp>
+#include <mdbg/sim/read_sim.hpp>
+
+#include <algorithm>
+#include <cstdint>
+#include <deque>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+namespace {
+
+  using node_sets_t = ::std::vector<::std::vector<::mdbg::node_hash>>;
+
+  ::mdbg::command_line_options options() {
+    ::mdbg::command_line_options opts{};
+    opts.threads = 1;
+    opts.k = 10;
+    opts.l = 14;
+    opts.d = 0.02;
+    return opts;
+  }
+
+  ::std::vector<::std::string> hifi_reads(
+    ::std::string const& genome,
+    ::std::uint64_t const seed
+  ) {
+    ::std::vector<::std::string> rv;
+    ::mdbg::sim::generate_reads(genome, {5'000, 1'000, 10},
+      ::mdbg::sim::error_models::PacBioHiFi, seed,
+      [&rv](auto, auto const& read) { rv.push_back(read); });
+    return rv;
+  }
+
+  // unitigs as the sorted hashes of their nodes, whatever strand and
+  // node they start from
+  node_sets_t node_sets(::mdbg::graph::simplified_graph_t const& unitigs) {
+    node_sets_t rv;
+    for (auto const& [start, chain] : unitigs) {
+      auto& nodes = rv.emplace_back();
+      for (auto const& [node, reverse] : chain) {
+        nodes.push_back(node.first.cached_hash);
+      }
+      ::std::sort(nodes.begin(), nodes.end());
+    }
+    ::std::sort(rv.begin(), rv.end());
+    return rv;
+  }
+
+}
+
+TEST_CASE("Resumed assembly", "[incremental]") {
+  auto genome = ::mdbg::sim::random_genome(200'000, 1);
+  ::mdbg::sim::inject_repeats(genome, {8, 3'000, 0.001, true}, 2);
+
+  // later reads only cover the start of the genome, the unitigs of the
+  // rest are kept as saved
+  auto const first = hifi_reads(genome, 3);
+  auto const second = hifi_reads(genome.substr(0, 40'000), 4);
+
+  auto const directory = ::std::filesystem::temp_directory_path() / "mdbg_test_incremental";
+  ::std::filesystem::create_directories(directory);
+  auto const graph_path = (directory / "saved.graph").string();
+  auto const unitigs_path = (directory / "saved.unitigs").string();
+
+  auto const opts = options();
+  {
+    // saved the way --save-graph does
+    ::mdbg::assembly_hooks hooks;
+    hooks.constructed = [&](auto const& graph) {
+      ::mdbg::graph::save_graph(graph_path, graph, first.size(), opts);
+    };
+    hooks.simplified = [&](auto const& simplified) {
+      ::mdbg::graph::save_unitigs(unitigs_path, simplified, opts);
+    };
+
+    ::mdbg::assembler assembler{opts};
+    for (auto const& read : first) {
+      assembler.push(read);
+    }
+    assembler.finish(hooks);
+  }
+
+  // the windows of the saved nodes have to outlive the graph
+  ::std::deque<::mdbg::read_minimizers_t> windows;
+  ::mdbg::assembler resumed{opts};
+  ::std::vector<::mdbg::graph::detail::compact_minimizer> boundary;
+
+  auto const header =
+    ::mdbg::graph::load_graph(graph_path, resumed.graph(), windows, boundary);
+  auto unitigs = ::mdbg::graph::load_unitigs(unitigs_path, opts);
+  auto const saved = unitigs.size();
+  resumed.resume(header.reads, ::std::move(unitigs));
+
+  ::std::filesystem::remove_all(directory);
+
+  for (auto const& read : second) {
+    resumed.push(read);
+  }
+
+  ::mdbg::graph::incremental_stats stats{};
+  ::mdbg::assembly_hooks hooks;
+  hooks.recomputed = [&stats](auto const& recomputed) { stats = recomputed; };
+  auto const incremental = resumed.finish(hooks);
+
+  ::mdbg::assembler rebuilt{opts};
+  for (auto const& read : first) {
+    rebuilt.push(read);
+  }
+  for (auto const& read : second) {
+    rebuilt.push(read);
+  }
+  auto const expected = rebuilt.finish();
+
+  REQUIRE(header.reads == first.size());
+  REQUIRE(stats.kept > 0);
+  REQUIRE(stats.kept < saved);
+  REQUIRE(stats.recomputed > 0);
+  REQUIRE(node_sets(incremental.unitigs()) == node_sets(expected.unitigs()));
+}
@@ -0,0 +1,126 @@
+#include <catch2/catch.hpp>
+
+#include <mdbg/minimizers.hpp>
+#include <mdbg/opt.hpp>
+#include <mdbg/sim/read_sim.hpp>
+
+#include <algorithm>
+#include <cstdint>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace {
+
+  // l of 14 runs the code compiled for it, 15 the generic one
+  ::mdbg::command_line_options options(
+    ::mdbg::minimizer_scheme const scheme,
+    ::std::size_t const l
+  ) {
+    ::mdbg::command_line_options opts{};
+    opts.k = 10;
+    opts.l = l;
+    opts.d = 0.05;
+    opts.scheme = scheme;
+    opts.resolve_defaults();
+    return opts;
+  }
+
+}
+
+TEST_CASE("Bounded gaps", "[minimizers]") {
+  auto const read = ::mdbg::sim::random_genome(20'000, 1);
+
+  for (auto const l : {14ul, 15ul}) {
+    // sparse enough that universe minimizers leave gaps to fill
+    auto opts = options(::mdbg::minimizer_scheme::bounded, l);
+    opts.d = 0.002;
+    opts.max_gap = 50;
+
+    auto const minimizers = ::mdbg::detect_minimizers(read, 0, opts);
+    auto const lmers = read.size() - l + 1;
+
+    REQUIRE(minimizers.size() >= lmers / opts.max_gap);
+    REQUIRE(minimizers.front().offset < opts.max_gap);
+    REQUIRE(minimizers.back().offset >= lmers - opts.max_gap);
+
+    for (::std::size_t i = 1; i < minimizers.size(); ++i) {
+      REQUIRE(minimizers[i].offset > minimizers[i - 1].offset);
+      REQUIRE(minimizers[i].offset - minimizers[i - 1].offset <= opts.max_gap);
+    }
+  }
+}
+
+TEST_CASE("Syncmers on both strands", "[minimizers]") {
+  auto const read = ::mdbg::sim::random_genome(20'000, 2);
+  auto reversed = read;
+  ::mdbg::sim::detail::reverse_complement(reversed);
+
+  for (auto const scheme : {
+      ::mdbg::minimizer_scheme::closed_syncmer,
+      ::mdbg::minimizer_scheme::open_syncmer}) {
+    for (auto const l : {14ul, 15ul}) {
+      auto const opts = options(scheme, l);
+
+      // minimizers as (offset on the forward strand, canonical hash)
+      auto const picked = [&opts](auto const& seq, bool const rc) {
+        ::std::vector<::std::pair<::std::size_t, ::std::uint64_t>> rv;
+        for (auto const& minimizer : ::mdbg::detect_minimizers(seq, 0, opts)) {
+          auto const offset = rc ? seq.size() - minimizer.offset - opts.l : minimizer.offset;
+          rv.push_back({offset, minimizer.minimizer});
+        }
+        ::std::sort(rv.begin(), rv.end());
+        return rv;
+      };
+
+      auto const forward = picked(read, false);
+      REQUIRE(forward.size() > read.size() * opts.d);
+      REQUIRE(forward == picked(reversed, true));
+    }
+  }
+}
+
+TEST_CASE("Homopolymer compressed spans", "[minimizers]") {
+  // every base of a random sequence without runs repeated one to four
+  // times
+  auto collapsed = ::mdbg::sim::random_genome(5'000, 3);
+  collapsed.erase(::std::unique(collapsed.begin(), collapsed.end()), collapsed.end());
+
+  ::std::mt19937_64 mt{4};
+  ::std::string read;
+  for (auto const base : collapsed) {
+    read.append(1 + mt() % 4, base);
+  }
+
+  for (auto const scheme : {
+      ::mdbg::minimizer_scheme::universe,
+      ::mdbg::minimizer_scheme::closed_syncmer,
+      ::mdbg::minimizer_scheme::bounded}) {
+    for (auto const l : {14ul, 15ul}) {
+      auto opts = options(scheme, l);
+      auto const expected = ::mdbg::detect_minimizers(collapsed, 0, opts);
+      opts.hpc = true;
+      auto const minimizers = ::mdbg::detect_minimizers(read, 0, opts);
+
+      REQUIRE(!minimizers.empty());
+      REQUIRE(minimizers.size() == expected.size());
+
+      for (::std::size_t i = 0; i < minimizers.size(); ++i) {
+        auto const& minimizer = minimizers[i];
+        REQUIRE(minimizer.minimizer == expected[i].minimizer);
+
+        // whole runs, which collapse into the l-mer picked without --hpc
+        auto const begin = minimizer.offset;
+        auto const end = begin + minimizer.length;
+        REQUIRE(end <= read.size());
+        REQUIRE((begin == 0 || read[begin - 1] != read[begin]));
+        REQUIRE((end == read.size() || read[end] != read[end - 1]));
+
+        auto spanned = read.substr(begin, minimizer.length);
+        spanned.erase(::std::unique(spanned.begin(), spanned.end()), spanned.end());
+        REQUIRE(spanned == collapsed.substr(expected[i].offset, l));
+      }
+    }
+  }
+}
@@ -0,0 +1,140 @@
+#include <catch2/catch.hpp>
+
+#include <mdbg/assembler.hpp>
+#include <mdbg/opt.hpp>
+#include <mdbg/sim/read_sim.hpp>
+
+#include <algorithm>
+#include <deque>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+namespace {
+
+  using node_sets_t = ::std::vector<::std::vector<::mdbg::node_hash>>;
+
+  // hifi reads of a genome with a few repeats, so that the graph
+  // branches and some erroneous nodes fall below the abundance filter
+  ::std::vector<::std::string> const& reads() {
+    static auto const rv = [] {
+      auto genome = ::mdbg::sim::random_genome(200'000, 1);
+      ::mdbg::sim::inject_repeats(genome, {8, 3'000, 0.001, true}, 2);
+
+      ::std::vector<::std::string> reads;
+      ::mdbg::sim::generate_reads(genome, {5'000, 1'000, 10},
+        ::mdbg::sim::error_models::PacBioHiFi, 3,
+        [&reads](auto, auto const& read) { reads.push_back(read); });
+      return reads;
+    }();
+    return rv;
+  }
+
+  ::mdbg::command_line_options options() {
+    ::mdbg::command_line_options opts{};
+    opts.threads = 1;
+    opts.k = 10;
+    opts.l = 14;
+    opts.d = 0.02;
+    opts.min_abundance = 2;
+    return opts;
+  }
+
+  // unitigs as the sorted hashes of their nodes, whatever strand and
+  // node they start from
+  node_sets_t node_sets(::mdbg::graph::simplified_graph_t const& unitigs) {
+    node_sets_t rv;
+    for (auto const& [start, chain] : unitigs) {
+      auto& nodes = rv.emplace_back();
+      for (auto const& [node, reverse] : chain) {
+        nodes.push_back(node.first.cached_hash);
+      }
+      ::std::sort(nodes.begin(), nodes.end());
+    }
+    ::std::sort(rv.begin(), rv.end());
+    return rv;
+  }
+
+  node_sets_t assemble(
+    ::mdbg::command_line_options const& opts,
+    ::mdbg::assembly_hooks const& hooks = {}
+  ) {
+    ::mdbg::assembler assembler{opts};
+    for (auto const& read : reads()) {
+      assembler.push(read);
+    }
+
+    auto const assembly = assembler.finish(hooks);
+    return node_sets(assembly.unitigs());
+  }
+
+}
+
+TEST_CASE("Partitioned assembly", "[partition]") {
+  ::std::size_t removed = 0;
+  ::mdbg::assembly_hooks filtered;
+  filtered.filtered = [&removed](auto const count) { removed = count; };
+
+  auto const expected = assemble(options(), filtered);
+  REQUIRE(expected.size() > 1);
+  REQUIRE(removed > 0);
+
+  auto const directory = ::std::filesystem::temp_directory_path() / "mdbg_test_partition";
+  ::std::filesystem::create_directories(directory);
+
+  // a budget below what the process holds puts every bucket into a
+  // partition of its own
+  auto opts = options();
+  opts.max_memory = 1;
+  opts.output_prefix = (directory / "assembly").string();
+
+  ::mdbg::graph::partition_stats stats{};
+  ::mdbg::assembly_hooks hooks;
+  hooks.partitioned = [&stats](auto const& partitioned) { stats = partitioned; };
+
+  auto const partitioned = assemble(opts, hooks);
+  ::std::filesystem::remove_all(directory);
+
+  REQUIRE(stats.partitions > 1);
+  REQUIRE(stats.fragments > expected.size());
+  REQUIRE(stats.removed == removed);
+  REQUIRE(partitioned == expected);
+}
+
+TEST_CASE("Partitions merged", "[partition]") {
+  auto const expected = assemble(options());
+
+  auto const directory = ::std::filesystem::temp_directory_path() / "mdbg_test_merge";
+  ::std::filesystem::create_directories(directory);
+
+  // each run builds and saves its partition of the nodes, as
+  // --partition i/N does, and they are joined the way 'mdbg merge' does
+  auto opts = options();
+  opts.partitions = 3;
+
+  ::std::vector<::std::string> paths;
+  for (opts.partition = 0; opts.partition < opts.partitions; ++opts.partition) {
+    ::mdbg::assembler assembler{opts};
+    for (auto const& read : reads()) {
+      assembler.push(read);
+    }
+
+    auto const assembly = assembler.finish();
+    paths.push_back(
+      ::mdbg::graph::partition_path((directory / "assembly").string(), opts));
+    ::mdbg::graph::save_graph(paths.back(), assembly.graph(), reads().size(), opts);
+  }
+
+  ::std::deque<::mdbg::read_minimizers_t> windows;
+  ::mdbg::graph::de_bruijn_graph_t dbg;
+  ::std::vector<::mdbg::graph::detail::compact_minimizer> boundary;
+
+  for (auto const& path : paths) {
+    ::mdbg::graph::load_graph(path, dbg, windows, boundary);
+  }
+  ::std::filesystem::remove_all(directory);
+
+  REQUIRE(!boundary.empty());
+  REQUIRE(::mdbg::graph::remove_dangling_edges(dbg, boundary) > 0);
+  REQUIRE(node_sets(::mdbg::graph::simplify(dbg)) == expected);
+}